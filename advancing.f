@@ -16,8 +16,10 @@ c temp data:
       real temp
       integer idum
       integer isubcycle
-      logical lcollide,lcstep
+      logical lcollide,lcstep,lblock
       real ctc,spsi,cpsi,rad,sd,sB
+      integer it,ichunk
+c$    integer omp_get_thread_num
 
 
 c Choose the collision cycle here and set tau appropriately:
@@ -82,6 +84,20 @@ c Set the sum of particles velocities to zero
       enddo
 
       ido=npart
+c With the domain decomposition the particles received from other
+c slabs may be in any slot up to iocprev.
+      if(ldd) ido=iocprev
+
+c The blocked push only handles full uninterrupted steps of the
+c cyclotronic integrator. Otherwise advance one particle at a time.
+      lblock=nblk.gt.0 .and. .not.lsubcycle .and. .not.lcollide
+     $     .and. .not.verlet
+c Threads take chunks of whole blocks.
+      ichunk=max(nblk,1)*max(1,256/max(nblk,1))
+      call padvmerge(0)
+c In fused mode the charge for the next step is deposited as each
+c particle's advance is finished.
+      if(lfused)call chargezero()
 
 c      write(*,*)'colnwt,tau,Eneutral,icycle',colnwt,tau,Eneutral,icycle
 c End of setup
@@ -89,9 +105,49 @@ c------------------ Iterate over particles --------------------------
 c No-subcycle default. Never gets changed w/o subcycling.
       dts=dtin
       isubcycle=1
+      it=0
+c When compiled with OpenMP the particles are shared among threads. The
+c reinjection complement cannot be split between threads, so only fixed
+c particle number runs are threaded. Nor is the fused deposit, which
+c sums into the shared moment arrays.
+c$omp parallel if(lfixedn .and. .not.lfused) default(shared)
+c$omp& firstprivate(dts,isubcycle,dt,it)
+c$omp& private(i,j,lb,il,rf,ith,tf,ipl,pf,st,ct,sp,cp,rp,zetap,ih,hf
+c$omp& ,remdt,ic,lcstep,cdt,accel,dtnow,temp,cosomdt,sinomdt,rn2,xdv
+c$omp& ,v2,tm,rn,dtl,xc,yc,zc,rad,ctc,spsi,cpsi,vxy,vr,ithc,tfc,icell
+c$omp& ,jpsic,pfc,jcell,v,ivdiag,thc,vz,vt)
+c$    it=omp_get_thread_num()
+c Position in the current block, set afresh in each thread.
+      lb=0
+      if(it.gt.0)then
+c Threads other than the master start from zeroed accumulators and draw
+c from their own random stream.
+         call padvmerge(1)
+         call rantseed((myid+1)*1000+it)
+      endif
+c$omp do schedule(static,ichunk)
+c$omp& reduction(+:ncollide) reduction(max:iocthis)
       do i=1,ido
 
+         if(lblock .and. mod(i-1,nblk).eq.0) then
+            call pushblock(i,min(nblk,ido-i+1),dtin,sd,sB)
+            lb=0
+         endif
+
          if(ipf(i).gt.0) then
+            if(lblock) then
+c     Already advanced by pushblock over the whole step. Pick up its
+c     acceleration and go straight to the boundary handling.
+               lb=lb+1
+               accel(1)=axpb(lb)
+               accel(2)=aypb(lb)
+               accel(3)=azpb(lb)
+               dt=dtin
+               remdt=0.
+               ic=1
+               lcstep=.false.
+               goto 83
+            endif
 c ````````````````````````````````````````` Treatment of active slot.
 c     Find the mesh position and the trigonometry.
 c     Here we do need half quantities.
@@ -311,10 +367,10 @@ c Second half of velocity advance
                      xp(j,i)=xp(j,i)+xp(j+3,i)*dt
                   enddo
                endif
-               
+
             endif
 
-            dtprec(i)=dt
+ 83         dtprec(i)=dt
             rn2=0.
             xdv=0.
             v2=0.
@@ -607,8 +663,14 @@ c     $           ,yorbit(iorbitlen(i),i),zorbit(iorbitlen(i),i)
 c     $           ,rorbit(iorbitlen(i),i)
             endif
 c------------------------End distribution diagnostics ---------------
-            if(ipf(i).gt.0)iocthis=i
+            if(ipf(i).gt.0)then
+               iocthis=i
+               if(lfused)call chargepart(i)
+            endif
             
+         elseif(ldd)then
+c Slot emptied by the domain decomposition. Fixed particle number.
+            goto 402
          elseif(nrein.lt.ninjcomp)then
 
 c ```````````````````````````````````````` Treatment of INactive slot.
@@ -623,11 +685,12 @@ c Still need to work on here.
             dtprec(i)=dtin
             ipf(i)=1
             iocthis=i
+            if(lfused)call chargepart(i)
          elseif(i.ge.iocprev)then
-c     Break if inactive slot and we have exhausted the complement of
+c     Skip if inactive slot and we have exhausted the complement of
 c     injections.  And we have reached the maximum occupied slot of
-c     previous run.
-            goto 401
+c     previous run. (The remaining slots are skipped the same way.)
+            goto 402
          endif
 c---------------- End of padvnc particle iteration ------------------
 
@@ -644,10 +707,16 @@ c     until the next timestep
             curr(4)=curr(4)+1
          endif
 
+ 402     continue
       enddo
-
-
- 401  continue
+c$omp end do
+      if(it.gt.0)then
+c$omp critical (padvacc)
+         call padvmerge(2)
+c$omp end critical (padvacc)
+      endif
+c$omp end parallel
+      call padvmerge(3)
 
       NCneutral=ncollide
 c      write(*,*)'ncollide=',ncollide,' icycle=',icycle
@@ -663,6 +732,337 @@ c     if(.not.lfixedn)write(*,504)ninjcomp,nrein,i,iocprev
  501  format('accel=',3f11.4,' xp=',3f11.4)
 
 
+      end
+c***********************************************************************
+c Merge the /padvacc/ sums of the threads of padvnc. That common is
+c threadprivate, so the merge goes through a saved (hence shared) buffer.
+c mode=0: zero the buffer. 1: zero this thread's sums, allocating its
+c arrays the first time. 2: add this thread's sums to the buffer.
+c 3: add the buffer to this thread's sums.
+      subroutine padvmerge(mode)
+      integer mode
+      include 'piccom.f'
+      integer nreinb,nreintryb,ninnerb,ntrapreb
+      real spotreinb,fluxreinb,zmomprobeb,xmomprobeb,ymomprobeb
+      real enerprobeb,zmoutb,xmoutb,ymoutb
+      real currb(4)
+      real, allocatable :: nincellb(:,:),vrincellb(:,:),vr2incellb(:,:)
+      real nvdiagb(nvmax),vrdiaginb(nvmax),vtdiaginb(nvmax)
+      save
+
+      if(mode.eq.0)then
+         if(.not.allocated(nincellb))allocate(nincellb(nthsize,npsisize)
+     $        ,vrincellb(nthsize,npsisize),vr2incellb(nthsize,npsisize))
+         nreinb=0
+         nreintryb=0
+         ninnerb=0
+         ntrapreb=0
+         spotreinb=0.
+         fluxreinb=0.
+         zmomprobeb=0.
+         xmomprobeb=0.
+         ymomprobeb=0.
+         enerprobeb=0.
+         zmoutb=0.
+         xmoutb=0.
+         ymoutb=0.
+         do k=1,4
+            currb(k)=0.
+         enddo
+         do k=1,npsisize
+            do j=1,nthsize
+               nincellb(j,k)=0.
+               vrincellb(j,k)=0.
+               vr2incellb(j,k)=0.
+            enddo
+         enddo
+         do k=1,nvmax
+            nvdiagb(k)=0.
+            vrdiaginb(k)=0.
+            vtdiaginb(k)=0.
+         enddo
+      elseif(mode.eq.1)then
+         if(.not.associated(nincell))allocate(nincell(nthsize,npsisize)
+     $        ,vrincell(nthsize,npsisize),vr2incell(nthsize,npsisize))
+         nrein=0
+         nreintry=0
+         ninner=0
+         ntrapre=0
+         spotrein=0.
+         fluxrein=0.
+         zmomprobe=0.
+         xmomprobe=0.
+         ymomprobe=0.
+         enerprobe=0.
+         zmout=0.
+         xmout=0.
+         ymout=0.
+         do k=1,4
+            curr(k)=0.
+         enddo
+         do k=1,npsisize
+            do j=1,nthsize
+               nincell(j,k)=0.
+               vrincell(j,k)=0.
+               vr2incell(j,k)=0.
+            enddo
+         enddo
+         do k=1,nvmax
+            nvdiag(k)=0.
+            vrdiagin(k)=0.
+            vtdiagin(k)=0.
+         enddo
+      elseif(mode.eq.2)then
+         nreinb=nreinb+nrein
+         nreintryb=nreintryb+nreintry
+         ninnerb=ninnerb+ninner
+         ntrapreb=ntrapreb+ntrapre
+         spotreinb=spotreinb+spotrein
+         fluxreinb=fluxreinb+fluxrein
+         zmomprobeb=zmomprobeb+zmomprobe
+         xmomprobeb=xmomprobeb+xmomprobe
+         ymomprobeb=ymomprobeb+ymomprobe
+         enerprobeb=enerprobeb+enerprobe
+         zmoutb=zmoutb+zmout
+         xmoutb=xmoutb+xmout
+         ymoutb=ymoutb+ymout
+         do k=1,4
+            currb(k)=currb(k)+curr(k)
+         enddo
+         do k=1,npsisize
+            do j=1,nthsize
+               nincellb(j,k)=nincellb(j,k)+nincell(j,k)
+               vrincellb(j,k)=vrincellb(j,k)+vrincell(j,k)
+               vr2incellb(j,k)=vr2incellb(j,k)+vr2incell(j,k)
+            enddo
+         enddo
+         do k=1,nvmax
+            nvdiagb(k)=nvdiagb(k)+nvdiag(k)
+            vrdiaginb(k)=vrdiaginb(k)+vrdiagin(k)
+            vtdiaginb(k)=vtdiaginb(k)+vtdiagin(k)
+         enddo
+      elseif(mode.eq.3)then
+         nrein=nrein+nreinb
+         nreintry=nreintry+nreintryb
+         ninner=ninner+ninnerb
+         ntrapre=ntrapre+ntrapreb
+         spotrein=spotrein+spotreinb
+         fluxrein=fluxrein+fluxreinb
+         zmomprobe=zmomprobe+zmomprobeb
+         xmomprobe=xmomprobe+xmomprobeb
+         ymomprobe=ymomprobe+ymomprobeb
+         enerprobe=enerprobe+enerprobeb
+         zmout=zmout+zmoutb
+         xmout=xmout+xmoutb
+         ymout=ymout+ymoutb
+         do k=1,4
+            curr(k)=curr(k)+currb(k)
+         enddo
+         do k=1,npsisize
+            do j=1,nthsize
+               nincell(j,k)=nincell(j,k)+nincellb(j,k)
+               vrincell(j,k)=vrincell(j,k)+vrincellb(j,k)
+               vr2incell(j,k)=vr2incell(j,k)+vr2incellb(j,k)
+            enddo
+         enddo
+         do k=1,nvmax
+            nvdiag(k)=nvdiag(k)+nvdiagb(k)
+            vrdiagin(k)=vrdiagin(k)+vrdiaginb(k)
+            vtdiagin(k)=vtdiagin(k)+vtdiaginb(k)
+         enddo
+      endif
+
+      end
+c***********************************************************************
+c Reorder the particles by the mesh cell they are in (psi, then theta,
+c then radius, the storage order of phi and the moment arrays), so that
+c consecutive particles in padvnc and chargetomesh use nearby mesh data.
+c A counting sort permutes xp, dtprec, vzinit and ipf together. Empty
+c slots go to the end and iocprev is lowered to the last occupied one.
+c The tracked orbit slots 1..norbits are left where they are.
+c The random draws and the deposit follow the slot order, so a sorted
+c run is statistically equivalent to an unsorted one, not identical.
+      subroutine partsort()
+      include 'piccom.f'
+      integer ncell
+      integer, allocatable :: ncount(:),icell(:),ipfs(:)
+      real, allocatable :: xps(:,:),dtps(:),vzps(:)
+      save ncount,icell,xps,dtps,vzps,ipfs
+
+      ncell=nrsize*nthsize*npsisize
+      if(.not.allocated(ncount))allocate(ncount(ncell+1)
+     $     ,icell(npartmax),xps(ndim,npartmax),dtps(npartmax)
+     $     ,vzps(npartmax),ipfs(npartmax))
+      i1=norbits+1
+      i2=iocprev
+      if(i2.le.i1)return
+      do k=1,ncell+1
+         ncount(k)=0
+      enddo
+c Cell of each slot, counted. Empty slots count in the last bin.
+      do i=i1,i2
+         if(ipf(i).gt.0)then
+            ih=0
+            hf=99.
+            call ptomesh(i,irl,rf,ithl,thf,ipl,pf,st,ct,sp,cp,rp
+     $           ,zetap,ih,hf)
+            icell(i)=irl+nrsize*(ithl-1+nthsize*(ipl-1))
+         else
+            icell(i)=ncell+1
+         endif
+         ncount(icell(i))=ncount(icell(i))+1
+      enddo
+c Starting offsets of each cell.
+      noff=i1
+      do k=1,ncell+1
+         nk=ncount(k)
+         ncount(k)=noff
+         noff=noff+nk
+      enddo
+c Scatter into the sorted copies, then copy back.
+      do i=i1,i2
+         k=ncount(icell(i))
+         ncount(icell(i))=k+1
+         do j=1,ndim
+            xps(j,k)=xp(j,i)
+         enddo
+         dtps(k)=dtprec(i)
+         vzps(k)=vzinit(i)
+         ipfs(k)=ipf(i)
+      enddo
+      do i=i1,i2
+         do j=1,ndim
+            xp(j,i)=xps(j,i)
+         enddo
+         dtprec(i)=dtps(i)
+         vzinit(i)=vzps(i)
+         ipf(i)=ipfs(i)
+      enddo
+c The empty slots start at the offset of the last bin.
+      iocprev=ncount(ncell)-1
+
+      end
+c***********************************************************************
+c Advance the active particles in slots i0 to i0+n-1 by a full step dt
+c with the cyclotronic integrator of padvnc. The particles are copied
+c into the /partblk/ buffers so that the kick, rotation and drift are
+c branch-free unit-stride loops that the compiler can vectorize. Mesh
+c location and field gather use table lookups so stay per particle.
+c Boundary handling is left to padvnc, which finds the accelerations
+c in axpb,aypb,azpb in the order of ipb.
+      subroutine pushblock(i0,n,dt,sd,sB)
+      integer i0,n
+      real dt,sd,sB
+      include 'piccom.f'
+      include 'errcom.f'
+      include 'colncom.f'
+      real accel(3)
+      real cosomdt,sinomdt,temp
+
+c Gather the active slots.
+      npb=0
+      do i=i0,i0+n-1
+         if(ipf(i).gt.0)then
+            npb=npb+1
+            ipb(npb)=i
+         endif
+      enddo
+      if(npb.eq.0) return
+
+c Locate and gather. Same half-mesh quantities as in padvnc.
+      do l=1,npb
+         i=ipb(l)
+         ih=1
+         hf=88.
+         call ptomesh(i,il,rf,ith,tf,ipl,pf,st,ct,sp,cp,rp
+     $        ,zetap,ih,hf)
+         call getaccel(i,accel,il,rf,ith,tf,ipl,pf,st,ct,
+     $        sp,cp,rp,zetap,ih,hf)
+         axpb(l)=accel(1)
+         aypb(l)=accel(2)+Eneutral*sd
+         azpb(l)=accel(3)+Eneutral*cd
+         dtpb(l)=0.5*(dt+dtprec(i))
+         xpb(l)=xp(1,i)
+         ypb(l)=xp(2,i)
+         zpb(l)=xp(3,i)
+         vxpb(l)=xp(4,i)
+         vypb(l)=xp(5,i)
+         vzpb(l)=xp(6,i)
+      enddo
+
+c Kick
+      do l=1,npb
+         vxpb(l)=vxpb(l)+axpb(l)*dtpb(l)
+         vypb(l)=vypb(l)+aypb(l)*dtpb(l)
+         vzpb(l)=vzpb(l)+azpb(l)*dtpb(l)
+      enddo
+
+      if(Bz.ne.0) then
+c Work in the frame where Econvective=0, with B along z.
+         do l=1,npb
+            vypb(l)=vypb(l)-vd*sd
+            vzpb(l)=vzpb(l)-vd*cd
+         enddo
+         if(cB.lt.0.999) then
+            do l=1,npb
+               temp=ypb(l)
+               ypb(l)=temp*cB-zpb(l)*sB
+               zpb(l)=zpb(l)*cB+temp*sB
+               temp=vypb(l)
+               vypb(l)=temp*cB-vzpb(l)*sB
+               vzpb(l)=vzpb(l)*cB+temp*sB
+            enddo
+         endif
+c All particles use the same dt, so the rotation is the same.
+         cosomdt=cos(Bz*dt)
+         sinomdt=sin(Bz*dt)
+         do l=1,npb
+            xpb(l)=xpb(l)+
+     $           (vypb(l)*(1-cosomdt)+vxpb(l)*sinomdt)/Bz
+            ypb(l)=ypb(l)+
+     $           (vxpb(l)*(cosomdt-1)+vypb(l)*sinomdt)/Bz
+            temp=vxpb(l)
+            vxpb(l)=temp*cosomdt+vypb(l)*sinomdt
+            vypb(l)=vypb(l)*cosomdt-temp*sinomdt
+            zpb(l)=zpb(l)+vzpb(l)*dt
+         enddo
+c Rotate and transform back
+         if(cB.lt.0.999) then
+            do l=1,npb
+               temp=ypb(l)
+               ypb(l)=temp*cB+zpb(l)*sB
+               zpb(l)=zpb(l)*cB-temp*sB
+               temp=vypb(l)
+               vypb(l)=temp*cB+vzpb(l)*sB
+               vzpb(l)=vzpb(l)*cB-temp*sB
+            enddo
+         endif
+         do l=1,npb
+            ypb(l)=ypb(l)+vd*sd*dt
+            zpb(l)=zpb(l)+vd*cd*dt
+            vypb(l)=vypb(l)+vd*sd
+            vzpb(l)=vzpb(l)+vd*cd
+         enddo
+      else
+c Drift
+         do l=1,npb
+            xpb(l)=xpb(l)+vxpb(l)*dt
+            ypb(l)=ypb(l)+vypb(l)*dt
+            zpb(l)=zpb(l)+vzpb(l)*dt
+         enddo
+      endif
+
+c Scatter back
+      do l=1,npb
+         i=ipb(l)
+         xp(1,i)=xpb(l)
+         xp(2,i)=ypb(l)
+         xp(3,i)=zpb(l)
+         xp(4,i)=vxpb(l)
+         xp(5,i)=vypb(l)
+         xp(6,i)=vzpb(l)
+      enddo
+
       end
 c***********************************************************************
 c***********************************************************************
@@ -819,6 +1219,8 @@ c Potential calculation in the shielding region
 c  bcp=1 -> Quasineutrality on the 15% outer crone
       if(bcphi.eq.1) then
          n1=nint(NRUSED*.85)-1
+c Processes sharing phi (lshmphi) do not write it, nor solve.
+         if(lshmphi)return
 
          do k=1,npsiused
             do j=1,nthused
@@ -834,6 +1236,7 @@ c bcp=2 -> Phiout=0
          
       elseif(bcphi.eq.2) then
          n1=nrused-1
+         if(lshmphi)return
 
          do k=0,npsiused+1
             do j=0,nthused+1
@@ -1003,6 +1406,8 @@ c      write(*,'($)')" "
 
 c*******************************************************************
       subroutine innerbc(imin,dt)
+c Set the probe potential, phi at imin, and vprobe. Processes sharing
+c phi (lshmphi) only update vprobe.
       include 'piccom.f'
       include 'errcom.f'
       real flogfac
@@ -1063,7 +1468,7 @@ c     Calculate the flux to each angular cell
                totflux=totflux+fluxofangle(j,k)
 
 
-               if(linsulate)then
+               if(linsulate.and..not.lshmphi)then
 
                   if(Bz.ne.0) then
                      do l=1,nPhi
@@ -1126,7 +1531,7 @@ c     calculate the total e- current to the sphere -> Irep
          endif
          
 c         write(*,*) vprobe,alog(totflux/nthused)+flogfac
-         if(lfloat)then
+         if(lfloat.and..not.lshmphi)then
             do j=1,nthused
                do k=1,npsiused
                   phi(imin,j,k)=vprobe
@@ -1145,6 +1550,7 @@ c Account for the convective Electric field due to Bz
          sB=sqrt(1-cB**2)
          sd=sqrt(1-cd**2)
          Exext=-vd*Bz*(cB*sd-sB*cd)
+         if(lshmphi)return
          do j=1,nthused
             do k=1,npsiused
 c               phi(imin,j,k)=vprobe
@@ -1,4 +1,3 @@
-
       subroutine cgparinit(myid2,cg_comm)
 
 c     Creates a new communicator, cg_comm, who contains a subset of
@@ -11,80 +10,262 @@ c     cg_comm
 c     myid2 is the process id in the new communicator. If myid2 is negative,
 c     the process does not belong to the communicator
 
-      integer myid2,nproccg
-
-c     Make sure the size is large enough when using many
-c     processors. With Loki, can't be larger than 512.
-      integer members(0:511)
-
-      integer group_world,cg_group,cg_comm
+      integer myid2,nproccg,nlay
+      integer cg_comm
+      integer ilay(3)
 
 
       include 'piccom.f'
       include 'errcom.f'
-      include 'mpif.h'
 
-      idim1=nint((numprocs*NRUSED**2/ (NTHUSED*NPSIUSED*1.))**(1./3))
-      idim2=nint((numprocs*NTHUSED**2/ (NRUSED*NPSIUSED*1.))**(1./3))
-      idim3=(numprocs/(idim1*idim2)*1.)
+      call cglayouts(nproccg,1,nlay,ilay)
+      idim1=ilay(1)
+      idim2=ilay(2)
+      idim3=ilay(3)
+      call cgcomm(nproccg,myid2,cg_comm)
 
-      
-      if(idim1.le.1) then
-         idim1=2
-         if(idim2.ge.4) then
-            idim2=idim2/2
-         else
-            idim3=idim3/2
-         endif
+      if (myid2.eq.0) then
+c         write(*,*) "cgp : ",idim1,idim2,nproccg,numprocs
+         write(*,510) idim1,idim2,idim3,nproccg
+ 510     format('BlocX=',i3,'  BlocY=',i3,'  BlocZ=',i3,'  CgProc=',i5)
       endif
-      if(idim2.le.1) then
-         idim2=2
-         if(idim3.ge.4) then
-            idim3=idim3/2
-         else
-            idim1=idim1/2
+
+      end
+
+c ------------------------------------------------------------------------
+      subroutine cglayouts(nproccg,nmax,nlay,ilay)
+
+c     The solver uses ncgproc processes (all if 0), or as many as can be
+c     arranged in idim1 x idim2 x idim3 blocks of at least 2 cells each
+c     way. Returns that number, nproccg, and the nlay (at most nmax)
+c     arrangements with the least work per block, counting the cells
+c     and the faces to exchange, best first in ilay(1:3,*). The blocks
+c     may differ by one cell in size.
+
+      integer nproccg,nmax,nlay
+      integer ilay(3,nmax)
+      integer ncell(3)
+      integer nlaymax
+      parameter (nlaymax=16)
+      real cost,cbest(nlaymax)
+
+      include 'piccom.f'
+
+c     Used cells in each dimension. The radial count is that of the
+c     smallest shielding region (bcphi=1).
+      ncell(1)=nint(NRUSED*.85)-2
+      ncell(2)=NTHUSED
+      ncell(3)=NPSIUSED
+
+      nproccg=numprocs
+      if(ncgproc.gt.0) nproccg=min(ncgproc,numprocs)
+
+ 10   nlay=0
+      do i1=1,ncell(1)/2
+         if(mod(nproccg,i1).eq.0)then
+            do i2=1,ncell(2)/2
+               if(mod(nproccg/i1,i2).eq.0)then
+                  i3=nproccg/(i1*i2)
+                  if(i3.le.ncell(3)/2)then
+                     ib1=(ncell(1)+i1-1)/i1
+                     ib2=(ncell(2)+i2-1)/i2
+                     ib3=(ncell(3)+i3-1)/i3
+                     cost=ib1*ib2*ib3
+                     if(i1.gt.1)cost=cost+2*ib2*ib3
+                     if(i2.gt.1)cost=cost+2*ib1*ib3
+                     if(i3.gt.1)cost=cost+2*ib1*ib2
+c     Insert in the list ordered by cost
+                     l=min(nlay+1,min(nmax,nlaymax))
+                     if(l.gt.nlay .or. cost.lt.cbest(l))then
+                        nlay=l
+ 11                     if(l.gt.1)then
+                           if(cost.lt.cbest(l-1))then
+                              cbest(l)=cbest(l-1)
+                              do m=1,3
+                                 ilay(m,l)=ilay(m,l-1)
+                              enddo
+                              l=l-1
+                              goto 11
+                           endif
+                        endif
+                        cbest(l)=cost
+                        ilay(1,l)=i1
+                        ilay(2,l)=i2
+                        ilay(3,l)=i3
+                     endif
+                  endif
+               endif
+            enddo
          endif
-      endif
-      if(idim3.le.1) then
-         idim3=2
-         if(idim2.ge.4) then
-            idim2=idim2/2
-         else
-            idim1=idim1/2
+      enddo
+      if(nlay.eq.0)then
+c     No arrangement of this many blocks fits the mesh
+         if(nproccg.gt.1)then
+            nproccg=nproccg-1
+            goto 10
          endif
-      endif
-      
-      nproccg=idim1*idim2*idim3
-      if(nproccg.gt.numprocs) idim1=idim1/2
-      nproccg=idim1*idim2*idim3
-
-c     Quick fix for only 8 processors 
-      if(numprocs.eq.8) then
-         nproccg=8
-         idim1=2
-         idim2=2
-         idim3=2
+         nlay=1
+         ilay(1,1)=1
+         ilay(2,1)=1
+         ilay(3,1)=1
       endif
 
-      do i=0,nproccg-1
-         members(i)=i
-      enddo
+      end
+
+c ------------------------------------------------------------------------
+      subroutine cgcomm(nproccg,myid2,cg_comm)
+
+c     Make cg_comm of the first nproccg processes, which get myid2>=0.
+
+      integer nproccg,myid2,cg_comm,icolor
+
+      include 'piccom.f'
+      include 'mpif.h'
 
-      call MPI_COMM_GROUP(MPI_COMM_WORLD,group_world,ierr)
-      call MPI_GROUP_INCL(group_world,nproccg,members,cg_group,ierr)
-      call MPI_GROUP_RANK(cg_group,myid2,ierr)
-      call MPI_COMM_CREATE(MPI_COMM_WORLD,cg_group,cg_comm,ierr)
-      if (myid2.ge.0) then
+      icolor=MPI_UNDEFINED
+      if(myid.lt.nproccg) icolor=0
+      call MPI_COMM_SPLIT(MPI_COMM_WORLD,icolor,myid,cg_comm,ierr)
+      if (cg_comm.ne.MPI_COMM_NULL) then
          call MPI_COMM_RANK(cg_comm,myid2,ierr)
+      else
+         myid2=-1
       endif
 
+      end
 
-      if (myid2.eq.0) then
-c         write(*,*) "cgp : ",idim1,idim2,nproccg,numprocs
-         write(*,510) idim1,idim2,idim3,nproccg
- 510     format('BlocX=',i2,'  BlocY=',i2,'  BlocZ=',i2,'  CgProc=',i2)
+c ------------------------------------------------------------------------
+      subroutine sptune(dt,n1,icolntype,colnwt,myid2,cg_comm)
+
+c     Time field solves on the current charge density with the serial
+c     solver and with the best few block layouts of the parallel one,
+c     and keep the fastest: sets cgparallel, idim1,2,3, myid2 and
+c     cg_comm. phi and phiaxis are restored afterwards.
+
+      real dt,colnwt
+      integer n1,icolntype,myid2,cg_comm
+c     Layouts tried and timed solves for each, after one untimed
+      integer ntmax,nrep
+      parameter (ntmax=4,nrep=2)
+      integer ilay(3,ntmax),nlay,nproccg,ibest
+      real ttune(0:ntmax),tsolve
+      double precision t0
+
+      include 'piccom.f'
+      include 'errcom.f'
+      include 'mpif.h'
+
+      real phitune(0:nrsize,0:nthsize,0:npsisize)
+      real phiaxtune(0:nrsize,2,0:npsisize)
+
+      do k=0,npsisize
+         do j=0,nthsize
+            do i=0,nrsize
+               phitune(i,j,k)=phi(i,j,k)
+            enddo
+         enddo
+         do j=1,2
+            do i=0,nrsize
+               phiaxtune(i,j,k)=phiaxis(i,j,k)
+            enddo
+         enddo
+      enddo
+      if(cgparallel .and. myid2.ge.0)call MPI_COMM_FREE(cg_comm,ierr)
+
+c     The trial solves print no iteration counts
+      lsolvequiet=.true.
+      call cglayouts(nproccg,ntmax,nlay,ilay)
+c     Layout 0 is the serial solver
+      do 20 it=0,nlay
+         if(it.eq.0)then
+            cgparallel=.false.
+            myid2=-1
+            if(myid.eq.0)myid2=0
+         else
+            cgparallel=.true.
+            idim1=ilay(1,it)
+            idim2=ilay(2,it)
+            idim3=ilay(3,it)
+            call cgcomm(nproccg,myid2,cg_comm)
+            call cg3dreset()
+         endif
+         t0=MPI_WTIME()
+         do irep=0,nrep
+            if(irep.eq.1)then
+               call MPI_BARRIER(MPI_COMM_WORLD,ierr)
+               t0=MPI_WTIME()
+            endif
+            do k=0,npsisize
+               do j=0,nthsize
+                  do i=0,nrsize
+                     phi(i,j,k)=phitune(i,j,k)
+                  enddo
+               enddo
+               do j=1,2
+                  do i=0,nrsize
+                     phiaxis(i,j,k)=phiaxtune(i,j,k)
+                  enddo
+               enddo
+            enddo
+            call shielding_bc(dt,n1,icolntype,colnwt)
+            if(.not.cgparallel .and. myid2.eq.0)then
+               call shielding3D(dt,n1)
+            elseif(cgparallel .and. myid2.ge.0)then
+               call shielding3D_par(dt,n1,cg_comm,myid2)
+            endif
+         enddo
+         tsolve=real((MPI_WTIME()-t0)/nrep)
+         call MPI_ALLREDUCE(tsolve,ttune(it),1,MPI_REAL,MPI_MAX,
+     $        MPI_COMM_WORLD,ierr)
+         if(cgparallel .and. myid2.ge.0)call MPI_COMM_FREE(cg_comm,ierr)
+ 20   continue
+
+      lsolvequiet=.false.
+      ibest=0
+      do it=1,nlay
+         if(ttune(it).lt.ttune(ibest))ibest=it
+      enddo
+      if(ibest.eq.0)then
+         cgparallel=.false.
+         myid2=-1
+         if(myid.eq.0)myid2=0
+      else
+         cgparallel=.true.
+         idim1=ilay(1,ibest)
+         idim2=ilay(2,ibest)
+         idim3=ilay(3,ibest)
+         call cgcomm(nproccg,myid2,cg_comm)
+         call cg3dreset()
       endif
 
+      do k=0,npsisize
+         do j=0,nthsize
+            do i=0,nrsize
+               phi(i,j,k)=phitune(i,j,k)
+            enddo
+         enddo
+         do j=1,2
+            do i=0,nrsize
+               phiaxis(i,j,k)=phiaxtune(i,j,k)
+            enddo
+         enddo
+      enddo
+
+      if(myid.eq.0)then
+         write(*,*)
+         write(*,511)ttune(0)
+         do it=1,nlay
+            write(*,512)(ilay(m,it),m=1,3),nproccg,ttune(it)
+         enddo
+         if(ibest.eq.0)then
+            write(*,*)'Using the serial solver'
+         else
+            write(*,510) idim1,idim2,idim3,nproccg
+         endif
+      endif
+ 510  format('BlocX=',i3,'  BlocY=',i3,'  BlocZ=',i3,'  CgProc=',i5)
+ 511  format('Solver time: serial',20x,f10.5)
+ 512  format('Solver time: ',i3,' x',i3,' x',i3,' on',i5,f10.5)
+
       end
 
 c ------------------------------------------------------------------------
@@ -96,7 +277,7 @@ c     q is the "charge density".
 c
       subroutine cg3dmpi(cg_comm,Li,Lj,Lk,ni,nj,nk,bcphi,u,q
      $     ,ictl,ierr,mpiid,idim1,idim2,idim3,apc,bpc,cpc,dpc,epc,fpc
-     $     ,gpc,b,x,p,res,z,pp,resr,zz,lbcg)
+     $     ,gpc,b,x,p,res,z,pp,resr,zz,dg,lbcg,wk,lpipe)
 
       integer cg_comm,mpiid
 c     The number of dimensions, 3 here.
@@ -106,21 +287,22 @@ c     Li leading dimension of i
 c     ni active dimension of i
       integer Li,Lj,Lk,ni,nj,nk
 c     In this mpi routine we must use linear addressing for cij,u,q
-c     so that the pointers can be used for each block.
-      real apc(*),bpc(*),cpc(*),dpc(*),epc(*),fpc(*)
+c     so that the pointers can be used for each block. They are passed
+c     whole, from radial index 0, so that index 1 is at radial index 1.
+      real apc(0:*),bpc(0:*),cpc(0:*),dpc(0:*),epc(0:*),fpc(0:*)
       real gpc(0:Lj-1,0:Lk-1,1:5)
 c     u  potential to be solved for (initialized on entry).
 c        its boundaries are at 1,ni; 1,nj; 
-      real u(*)
+      real u(0:*)
 c     q  "charge density" input
-      real q(*)
+      real q(0:*)
 c     mpiid Returns my MPI process number for this mpi version.
       integer ictl,ierr,kc
 c     idim1,2,3   The number of blocks in dimensions 1, 2 and 3
       integer idim1,idim2,idim3
      
 
-      common /cg3dctl/icg_mi,cg_eps,cg_del,icg_k
+      common /cg3dctl/icg_mi,cg_eps,cg_del,icg_k,cg_rtol,cg_res
 
 c      Other things that we might want control over include the maximum
 c     number of iterations and the convergence size.
@@ -135,8 +317,10 @@ c     for convergence.
 
 c     BC
       integer bcphi
-c     lflag, decide if we call bbdy for the first time or not
+c     lflag, decide if we call bbdy for the first time or not. It is
+c     reset by cg3dreset when cg_comm or the layout change.
       logical lflag
+      common /cgbbdy/lflag
 
       
       include 'piccomcg.f'
@@ -162,15 +346,27 @@ c     Index for array storage
       real bknum,bknumR,bkden,akden,akdenR
 c     Temporary arrays for the cg solver
       real b(*),x(*),p(*),res(*),z(*),pp(*),resr(*),zz(*)
+c     Diagonal fpc+exp(u) of A, constant during the solve
+      real dg(*)
       
 c     Flag to use biconjugate gradient method (not minimum residual)
       logical lbcg
+c     Flag to use the pipelined variant, and its workspace of 10 arrays
+c     of the size of x
+      logical lpipe
+      real wk(*)
+c     Dot products and largest change reduced together by the pipelined
+c     variant, with their datatype and operator
+      real dots(5),dotsR(5)
+      integer icgtype,icgop,ireqr
+      logical lpinit
+      external cgpipeop
+      data lpinit/.false./
+      save icgtype,icgop,lpinit
 
  
 c-------------------------------------------------------------------
 
-      save lflag
-
 c Required iterations at the previous step
       icg_prec=icg_k
 
@@ -190,7 +386,7 @@ c Initialize denominators to avoid compilation warnings
       ifull(1)=Li
       ifull(2)=Lj
       ifull(3)=nk
-      if((idims(1)+1)*(idims(2)+1)*idims(3).gt.norigmax)then
+      if((idims(1)+1)*(idims(2)+1)*(idims(3)+1).gt.norigmax)then
          write(*,*)'Too many processes',idims(1),' x ',idims(2),' x '
      $        ,idims(3),' for norigmax=',norigmax
          stop
@@ -207,12 +403,17 @@ c-------------------------------------------------------------------
       
 
 c Do block boundary communications, returns block info icoords...myid.
-      call bbdy(cg_comm,iLs,iuds,u,icg_k,iorig,ndims,idims,lperiod,
+      call bbdy(cg_comm,iLs,iuds,u(1),icg_k,iorig,ndims,idims,lperiod,
      $     icoords,iLcoords,myside,myorig,myorig1,myorig2,myorig3,
      $     icommcart,mycartid,mpiid,lflag,out,inn)
 
 
 
+c The diagonal of A depends on u through exp(u): evaluate it once here
+c rather than in every atimesmpi and asolvempi call.
+      call diagmpi(myside(1),myside(2),myside(3),Li,Lj,u(myorig)
+     $     ,fpc(myorig1+Li*myorig2),dg(myorig))
+
 c For debugging, if lAdebug flag set, only multiply by A; do not solve
       if (lAdebug) then
 c        Communicate x on boundaries (needed for psi periodicity)
@@ -221,10 +422,10 @@ c        Communicate x on boundaries (needed for psi periodicity)
      $     icommcart,mycartid,mpiid,lflag,out,inn)
 c        Do matrix multiplication
          call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,x(myorig)
-     $     ,res(myorig),u(myorig),apc(myorig1),bpc(myorig1) ,cpc(myorig1
-     $     +Li*myorig2) ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
-     $     ,fpc(myorig1+Li*myorig2)
-     $     ,gpc(myorig2,myorig3,1), out, lAtranspose)
+     $     ,res(myorig),dg(myorig),apc(myorig1),bpc(myorig1)
+     $     ,cpc(myorig1+Li*myorig2),dpc(myorig1+Li*myorig2)
+     $     ,epc(myorig1+Li*myorig2)
+     $     ,gpc(myorig2,myorig3,1), out, lAtranspose,0)
 c        Do the final mpi_gather
          kc=-1
          call bbdy(cg_comm,iLs,iuds,res,kc,iorig,ndims,idims,lperiod,
@@ -272,10 +473,10 @@ c                    For debugging, set b to zero as well
 
 c Outputs Ax, where A is the cg matrix
       call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,x(myorig)
-     $     ,res(myorig),u(myorig),apc(myorig1),bpc(myorig1) ,cpc(myorig1
-     $     +Li*myorig2) ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
-     $     ,fpc(myorig1+Li *myorig2) ,gpc(myorig2,myorig3,1),out,
-     $     .false.)
+     $     ,res(myorig),dg(myorig),apc(myorig1),bpc(myorig1)
+     $     ,cpc(myorig1+Li*myorig2),dpc(myorig1+Li*myorig2)
+     $     ,epc(myorig1+Li*myorig2),gpc(myorig2,myorig3,1),out,
+     $     .false.,0)
 
       
 c     Calculate the initial residual r=b-Ax, where x is the potential at
@@ -284,18 +485,29 @@ c     first search direction is the first residual
       
 
       
+      fres=0.
       do k=2,myside(3)-1
          do j=2,myside(2)-1
             do i=1,myside(1)-1
                index=myorig+(i-1)*iLs(1)+(j-1)*iLs(2)+(k-1)*iLs(3)
                res(index)=b(index)-res(index)
                if(inn.and.i.eq.1) res(index)=0.
+               if(i.ge.2) fres=max(fres,abs(res(index)))
 c              The following line is required for the bcg method
                resr(index)=res(index)
             enddo
          enddo
       enddo
 
+c     Largest initial residual over all the blocks. If it is below
+c     cg_rtol, u is already a solution.
+      call MPI_ALLREDUCE(fres,cg_res,1,MPI_REAL,MPI_MAX,icommcart,ierr)
+      if(cg_res.lt.cg_rtol)then
+         deltamax=0.
+         icg_k=0
+         goto 11
+      endif
+
 
 c For the next atimesmpi, need res also on the shadow cells
       call bbdy(cg_comm,iLs,iuds,res,icg_k,iorig,ndims,idims,lperiod,
@@ -309,18 +521,19 @@ c     Following call used for minimum residual method
       if (.not. lbcg) then
          call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk
      $     ,res(myorig)
-     $     ,resr(myorig),u(myorig),apc(myorig1) ,bpc(myorig1)
+     $     ,resr(myorig),dg(myorig),apc(myorig1) ,bpc(myorig1)
      $     ,cpc(myorig1+Li*myorig2) ,dpc(myorig1+Li *myorig2)
-     $     ,epc(myorig1+Li*myorig2) ,fpc(myorig1+Li*myorig2)
+     $     ,epc(myorig1+Li*myorig2)
      $     ,gpc(myorig2,myorig3 ,1),out,
-     $     .false.)
+     $     .false.,0)
       endif
 
 
       call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
-     $     ,res(myorig),z(myorig),u(myorig),apc(myorig1),fpc(myorig1
-     $     +Li*myorig2),gpc(myorig2,myorig3 ,1),out)
+     $     ,res(myorig),z(myorig),dg(myorig),apc(myorig1)
+     $     ,gpc(myorig2,myorig3 ,1),out)
 
+      if(lpipe) goto 20
 
 c     Start Main iteration  
 
@@ -334,8 +547,8 @@ c     Start Main iteration
 c Do block boundary communications
 
          call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
-     $        ,resr(myorig),zz(myorig),u(myorig),apc(myorig1)
-     $        ,fpc(myorig1 +Li*myorig2),gpc(myorig2,myorig3 ,1),out)
+     $        ,resr(myorig),zz(myorig),dg(myorig),apc(myorig1)
+     $        ,gpc(myorig2,myorig3 ,1),out)
 
          
          
@@ -404,17 +617,26 @@ c     Sum bknum over all the participating nodes
 
          bkden=bknum
 
-         call bbdy(cg_comm,iLs,iuds,p,icg_k,iorig,ndims,idims,lperiod,
+c Exchange the faces of p while the interior of z=Ap is computed,
+c then do the layer next to the faces.
+         kc=-2
+         call bbdy(cg_comm,iLs,iuds,p,kc,iorig,ndims,idims,lperiod,
      $        icoords,iLcoords,myside,myorig,myorig1,myorig2,myorig3,
      $        icommcart,mycartid,mpiid,lflag,out,inn)
-
-
-         call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,p(myorig)
-     $        ,z(myorig),u(myorig),apc(myorig1),bpc(myorig1),cpc(myorig1
-     $        +Li*myorig2) ,dpc(myorig1+Li*myorig2),epc(myorig1+Li
-     $        *myorig2) ,fpc(myorig1+Li *myorig2) ,gpc(myorig2,myorig3,1
-     $        ) ,out,
-     $     .false.)
+         do iphase=1,2
+            call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $           ,p(myorig),z(myorig),dg(myorig),apc(myorig1)
+     $           ,bpc(myorig1),cpc(myorig1+Li*myorig2)
+     $           ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
+     $           ,gpc(myorig2,myorig3,1),out,.false.,iphase)
+            if(iphase.eq.1)then
+               kc=-3
+               call bbdy(cg_comm,iLs,iuds,p,kc,iorig,ndims,idims,
+     $              lperiod,icoords,iLcoords,myside,myorig,myorig1,
+     $              myorig2,myorig3,icommcart,mycartid,mpiid,lflag,
+     $              out,inn)
+            endif
+         enddo
 
          
          akden=0.
@@ -434,17 +656,26 @@ c Sum akden over all the participating nodes
 
          ak=bknum/akden
          
-         call bbdy(cg_comm,iLs,iuds,pp,icg_k,iorig,ndims,idims,lperiod,
+         kc=-2
+         call bbdy(cg_comm,iLs,iuds,pp,kc,iorig,ndims,idims,lperiod,
      $        icoords,iLcoords,myside,myorig,myorig1,myorig2,myorig3,
      $        icommcart,mycartid,mpiid,lflag,out,inn)
 
 c        Implement bcg option by using lbcg as transpose flag
-         call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,
-     $     pp(myorig),zz(myorig),u(myorig),apc(myorig1),bpc(myorig1)
-     $     ,cpc(myorig1+Li*myorig2) ,dpc(myorig1+Li*myorig2)
-     $     ,epc(myorig1+Li*myorig2) ,fpc(myorig1+Li *myorig2)
-     $     ,gpc(myorig2,myorig3,1), out,
-     $     lbcg)
+         do iphase=1,2
+            call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,
+     $           pp(myorig),zz(myorig),dg(myorig),apc(myorig1)
+     $           ,bpc(myorig1),cpc(myorig1+Li*myorig2)
+     $           ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
+     $           ,gpc(myorig2,myorig3,1),out,lbcg,iphase)
+            if(iphase.eq.1)then
+               kc=-3
+               call bbdy(cg_comm,iLs,iuds,pp,kc,iorig,ndims,idims,
+     $              lperiod,icoords,iLcoords,myside,myorig,myorig1,
+     $              myorig2,myorig3,icommcart,mycartid,mpiid,lflag,
+     $              out,inn)
+            endif
+         enddo
 
          deltamax=0.
          
@@ -475,13 +706,194 @@ c            if(mpiid.eq.1)   write(*,*) icg_k,deltamax,lconverged
 
 
          call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
-     $        ,res(myorig),z(myorig),u(myorig),apc(myorig1) ,fpc(myorig1
-     $        +Li*myorig2),gpc(myorig2,myorig3 ,1),out)
+     $        ,res(myorig),z(myorig),dg(myorig),apc(myorig1)
+     $        ,gpc(myorig2,myorig3 ,1),out)
 
          
       enddo
 c     After a loop is finished, fortran seems to increase the counter one more
       icg_k=icg_k-1
+      goto 11
+
+c-------------------------------------------------------------------
+c Pipelined BiCG. The products w=Az and ww=Bzz (B is A' for bcg, A for
+c minimum residual) of the preconditioned residuals are carried by
+c recurrences, as are s=Ap, ss=Bpp and q=AM^-1 s, qq=BM^-1 ss. All the
+c dot products of an iteration, and the largest change of the previous
+c one for the convergence test, are then available together and are
+c summed by one non-blocking reduction, during which n=AM^-1 w and
+c nn=BM^-1 ww are computed. The denominator (pp,Ap) is expanded in
+c terms of the old p,pp so that it needs no second reduction.
+ 20   continue
+      if(.not.lpinit)then
+         call MPI_TYPE_CONTIGUOUS(5,MPI_REAL,icgtype,ierr)
+         call MPI_TYPE_COMMIT(icgtype,ierr)
+         call MPI_OP_CREATE(cgpipeop,.true.,icgop,ierr)
+         lpinit=.true.
+      endif
+c Offsets of w,ww,s,ss,q,qq,m=M^-1 w,mm,n,nn in wk
+      nwk=Li*Lj*Lk
+      jw=0
+      jww=nwk
+      js=2*nwk
+      jss=3*nwk
+      jq=4*nwk
+      jqq=5*nwk
+      jm=6*nwk
+      jmm=7*nwk
+      jn=8*nwk
+      jnn=9*nwk
+c The ghost cells of m and mm that are not exchanged must be zero
+      do k=1,myside(3)
+         do j=1,myside(2)
+            do i=1,myside(1)
+               index=myorig+(i-1)*iLs(1)+(j-1)*iLs(2)+(k-1)*iLs(3)
+               do l=0,9*nwk,nwk
+                  wk(l+index)=0.
+               enddo
+               p(index)=0.
+               pp(index)=0.
+            enddo
+         enddo
+      enddo
+
+c w=Az, ww=Bzz with zz=M^-1 rr
+      call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $     ,resr(myorig),zz(myorig),dg(myorig),apc(myorig1)
+     $     ,gpc(myorig2,myorig3 ,1),out)
+      call bbdy(cg_comm,iLs,iuds,z,icg_k,iorig,ndims,idims,lperiod,
+     $     icoords,iLcoords,myside,myorig,myorig1,myorig2,myorig3,
+     $     icommcart,mycartid,mpiid,lflag,out,inn)
+      call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,z(myorig)
+     $     ,wk(jw+myorig),dg(myorig),apc(myorig1),bpc(myorig1)
+     $     ,cpc(myorig1+Li*myorig2),dpc(myorig1+Li*myorig2)
+     $     ,epc(myorig1+Li*myorig2),gpc(myorig2,myorig3,1),out,
+     $     .false.,0)
+      call bbdy(cg_comm,iLs,iuds,zz,icg_k,iorig,ndims,idims,lperiod,
+     $     icoords,iLcoords,myside,myorig,myorig1,myorig2,myorig3,
+     $     icommcart,mycartid,mpiid,lflag,out,inn)
+      call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk,zz(myorig)
+     $     ,wk(jww+myorig),dg(myorig),apc(myorig1),bpc(myorig1)
+     $     ,cpc(myorig1+Li*myorig2),dpc(myorig1+Li*myorig2)
+     $     ,epc(myorig1+Li*myorig2),gpc(myorig2,myorig3,1),out,
+     $     lbcg,0)
+
+      bkden=1.
+      akden=1.
+      deltamax=0.
+      do icg_k=1,icg_mi
+
+         if(icg_k.gt.1)then
+            call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $           ,res(myorig),z(myorig),dg(myorig),apc(myorig1)
+     $           ,gpc(myorig2,myorig3 ,1),out)
+            call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $           ,resr(myorig),zz(myorig),dg(myorig),apc(myorig1)
+     $           ,gpc(myorig2,myorig3 ,1),out)
+         endif
+         call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $        ,wk(jw+myorig),wk(jm+myorig),dg(myorig),apc(myorig1)
+     $        ,gpc(myorig2,myorig3 ,1),out)
+         call asolvempi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $        ,wk(jww+myorig),wk(jmm+myorig),dg(myorig),apc(myorig1)
+     $        ,gpc(myorig2,myorig3 ,1),out)
+
+c (z,rr), (w,zz), (s,zz), (w,pp) and the largest change
+         do l=1,4
+            dots(l)=0.
+         enddo
+         do k=2,myside(3)-1
+            do j=2,myside(2)-1
+               do i=2,myside(1)-1
+                  index=myorig+(i-1)*iLs(1)+(j-1)*iLs(2)+(k-1)*iLs(3)
+                  dots(1)=dots(1)+z(index)*resr(index)
+                  dots(2)=dots(2)+wk(jw+index)*zz(index)
+                  dots(3)=dots(3)+wk(js+index)*zz(index)
+                  dots(4)=dots(4)+wk(jw+index)*pp(index)
+               enddo
+            enddo
+         enddo
+         dots(5)=deltamax
+         call MPI_IALLREDUCE(dots,dotsR,1,icgtype,icgop,icommcart,
+     $        ireqr,ierr)
+
+c n=Am and nn=Bmm while the reduction proceeds
+         kc=-2
+         call bbdy(cg_comm,iLs,iuds,wk(jm+1),kc,iorig,ndims,idims,
+     $        lperiod,icoords,iLcoords,myside,myorig,myorig1,myorig2,
+     $        myorig3,icommcart,mycartid,mpiid,lflag,out,inn)
+         do iphase=1,2
+            call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $           ,wk(jm+myorig),wk(jn+myorig),dg(myorig),apc(myorig1)
+     $           ,bpc(myorig1),cpc(myorig1+Li*myorig2)
+     $           ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
+     $           ,gpc(myorig2,myorig3,1),out,.false.,iphase)
+            if(iphase.eq.1)then
+               kc=-3
+               call bbdy(cg_comm,iLs,iuds,wk(jm+1),kc,iorig,ndims,
+     $              idims,lperiod,icoords,iLcoords,myside,myorig,
+     $              myorig1,myorig2,myorig3,icommcart,mycartid,mpiid,
+     $              lflag,out,inn)
+            endif
+         enddo
+         kc=-2
+         call bbdy(cg_comm,iLs,iuds,wk(jmm+1),kc,iorig,ndims,idims,
+     $        lperiod,icoords,iLcoords,myside,myorig,myorig1,myorig2,
+     $        myorig3,icommcart,mycartid,mpiid,lflag,out,inn)
+         do iphase=1,2
+            call atimesmpi(myside(1),myside(2),myside(3),Li,Lj,Lk
+     $           ,wk(jmm+myorig),wk(jnn+myorig),dg(myorig)
+     $           ,apc(myorig1),bpc(myorig1),cpc(myorig1+Li*myorig2)
+     $           ,dpc(myorig1+Li*myorig2),epc(myorig1+Li*myorig2)
+     $           ,gpc(myorig2,myorig3,1),out,lbcg,iphase)
+            if(iphase.eq.1)then
+               kc=-3
+               call bbdy(cg_comm,iLs,iuds,wk(jmm+1),kc,iorig,ndims,
+     $              idims,lperiod,icoords,iLcoords,myside,myorig,
+     $              myorig1,myorig2,myorig3,icommcart,mycartid,mpiid,
+     $              lflag,out,inn)
+            endif
+         enddo
+
+         call MPI_WAIT(ireqr,MPI_STATUS_IGNORE,ierr)
+
+c The change reduced is that of the previous iteration
+         if(icg_k.gt.2 .and. dotsR(5).lt.cg_eps)then
+            deltamax=dotsR(5)
+            goto 21
+         endif
+
+         bknum=dotsR(1)
+         bk=0.
+         if(icg_k.gt.1)bk=bknum/bkden
+         akden=dotsR(2)+bk*(dotsR(3)+dotsR(4))+bk*bk*akden
+         ak=bknum/akden
+
+         deltamax=0.
+         do k=2,myside(3)-1
+            do j=2,myside(2)-1
+               do i=2,myside(1)-1
+                  index=myorig+(i-1)*iLs(1)+(j-1)*iLs(2)+(k-1)*iLs(3)
+                  p(index)=bk*p(index)+z(index)
+                  pp(index)=bk*pp(index)+zz(index)
+                  wk(js+index)=bk*wk(js+index)+wk(jw+index)
+                  wk(jss+index)=bk*wk(jss+index)+wk(jww+index)
+                  wk(jq+index)=bk*wk(jq+index)+wk(jn+index)
+                  wk(jqq+index)=bk*wk(jqq+index)+wk(jnn+index)
+                  delta=ak*p(index)
+                  x(index)=x(index)+delta
+                  if(abs(delta).gt.deltamax)deltamax=abs(delta)
+                  res(index)=res(index)-ak*wk(js+index)
+                  resr(index)=resr(index)-ak*wk(jss+index)
+                  wk(jw+index)=wk(jw+index)-ak*wk(jq+index)
+                  wk(jww+index)=wk(jww+index)-ak*wk(jqq+index)
+               enddo
+            enddo
+         enddo
+         bkden=bknum
+
+      enddo
+ 21   icg_k=icg_k-1
 
 c-------------------------------------------------------------------
  11   continue
@@ -511,20 +923,71 @@ c      mpiid=myid
       end
 
 
+c***********************************************************************
+c Make the next cg3dmpi call set up the block communications again,
+c for a new cg_comm or block layout.
+      subroutine cg3dreset()
+      logical lflag
+      common /cgbbdy/lflag
+
+      lflag=.false.
+
+      end
+
 c***********************************************************************
 c Outputs res=Ax, where A is the finite volumes stiffness matrix
-      subroutine atimesmpi(ni,nj,nk,Li,Lj,Lk,x,res,u,a,b,c,d,e,f,g,out,
-     $  ltrnsp)
+      subroutine atimesmpi(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $  ltrnsp,iphase)
 
+c iphase selects the cells computed, so that the halo exchange of x
+c can proceed during the part that does not need it:
+c 0 all the cells, 1 the interior cells 3..n-2, which use no ghost
+c value, 2 the remaining layer next to the faces.
       
 c      integer ni,nj,nk
 c      integer Li,Lj,Lk
 
       logical out
-      real x(Li,Lj,nk),res(Li,Lj,nk),u(Li,Lj,nk)
-      real a(ni),b(ni),c(Li,nj),d(Li,nj),e(Li,nj),f(Li,nj),g(Lj,Lk,5)
+      real x(Li,Lj,nk),res(Li,Lj,nk),dg(Li,Lj,nk)
+      real a(ni),b(ni),c(Li,nj),d(Li,nj),e(Li,nj),g(Lj,Lk,5)
       logical ltrnsp
+      integer iphase
+
+      if(iphase.eq.1)then
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,3,ni-2,3,nj-2,3,nk-2)
+      elseif(iphase.eq.2)then
+c The k faces, then the j faces, then the i faces of what remains
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,ni-1,2,nj-1,2,2)
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,ni-1,2,nj-1,max(3,nk-1),nk-1)
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,ni-1,2,2,3,nk-2)
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,ni-1,max(3,nj-1),nj-1,3,nk-2)
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,2,3,nj-2,3,nk-2)
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,max(3,ni-1),ni-1,3,nj-2,3,nk-2)
+      else
+         call atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $        ltrnsp,2,ni-1,2,nj-1,2,nk-1)
+      endif
+
+      end
+c***********************************************************************
+c Matrix multiplication of atimesmpi restricted to the cells i1..i2,
+c j1..j2, k1..k2. Each cell is computed completely, so the boxes may
+c be done in any order.
+      subroutine atimesbox(ni,nj,nk,Li,Lj,Lk,x,res,dg,a,b,c,d,e,g,out,
+     $  ltrnsp,i1,i2,j1,j2,k1,k2)
 
+      logical out
+      real x(Li,Lj,nk),res(Li,Lj,nk),dg(Li,Lj,nk)
+      real a(ni),b(ni),c(Li,nj),d(Li,nj),e(Li,nj),g(Lj,Lk,5)
+      logical ltrnsp
+      integer i1,i2,j1,j2,k1,k2
 
 c The numbering starts at 1 and ends at n, but 1 and n are the ghost cells
 
@@ -532,28 +995,28 @@ c The numbering starts at 1 and ends at n, but 1 and n are the ghost cells
 
 
 c Matrix multiplication
-      do k=2,nk-1
-         do j=2,nj-1
-            do i=2,ni-1
+      do k=k1,k2
+         do j=j1,j2
+            do i=i1,i2
                res(i,j,k) = b(i+1)*x(i+1,j,k)
      $           + a(i-1)*x(i-1,j,k)
      $           + d(i,j+1)*x(i,j+1,k)
      $           + c(i,j-1)*x(i,j-1,k)
      $           + e(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $           - (f(i,j)+exp(u(i,j,k)))*x(i,j,k)
+     $           - dg(i,j,k)*x(i,j,k)
             enddo
          enddo
       enddo
 
 c Take care of outer boundary condition
       if(out) then
-         do k=2,nk-1
-            do j=2,nj-1
+         do k=k1,k2
+            do j=j1,j2
                i=ni-2
-               res(i,j,k) = res(i,j,k)
+               if(i.ge.i1 .and. i.le.i2) res(i,j,k) = res(i,j,k)
      $           + g(j,k,1)*a(i+1)*x(i+1,j,k)
                i=ni-1
-               res(i,j,k) = res(i,j,k)
+               if(i.ge.i1 .and. i.le.i2) res(i,j,k) = res(i,j,k)
      $           + g(j+1,k,2)*a(i)*x(i,j+1,k)
      $           + g(j-1,k,3)*a(i)*x(i,j-1,k)
      $           + g(j,k,5)*a(i)*x(i,j,k)
@@ -566,25 +1029,26 @@ c Take care of outer boundary condition
       else
 
 c Matrix multiplication
-      do k=2,nk-1
-         do j=2,nj-1
-            do i=2,ni-2
+      do k=k1,k2
+         do j=j1,j2
+            do i=i1,min(i2,ni-2)
                res(i,j,k) = a(i)*x(i+1,j,k)
      $           + b(i)*x(i-1,j,k)
      $           + c(i,j)*x(i,j+1,k)
      $           + d(i,j)*x(i,j-1,k)
      $           + e(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $           - (f(i,j)+exp(u(i,j,k)))*x(i ,j,k)
+     $           - dg(i,j,k)*x(i ,j,k)
             enddo
          enddo
       enddo
 
+      if(i2.lt.ni-1) return
 
 c Take care of outer boundary condition
       i=ni-1
       if(out) then
-         do k=2,nk-1
-            do j=2,nj-1
+         do k=k1,k2
+            do j=j1,j2
                x(i+1,j,k) = g(j,k,1)*x(i-1,j,k)
      $           + g(j,k,2)*x(i,j-1,k)
      $           + g(j,k,3)*x(i,j+1,k)
@@ -596,18 +1060,18 @@ c Take care of outer boundary condition
      $           + c(i,j)*x(i,j+1,k)
      $           + d(i,j)*x(i,j-1,k)
      $           + e(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $           - (f(i,j)+exp(u(i,j,k)))*x(i ,j,k)
+     $           - dg(i,j,k)*x(i ,j,k)
             enddo
          enddo
       else
-         do k=2,nk-1
-            do j=2,nj-1
+         do k=k1,k2
+            do j=j1,j2
                res(i,j,k) = a(i)*x(i+1,j,k)
      $           + b(i)*x(i-1,j,k)
      $           + c(i,j)*x(i,j+1,k)
      $           + d(i,j)*x(i,j-1,k)
      $           + e(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $           - (f(i,j)+exp(u(i,j,k)))*x(i ,j,k)
+     $           - dg(i,j,k)*x(i ,j,k)
             enddo
          enddo
       endif
@@ -615,19 +1079,35 @@ c Take care of outer boundary condition
       endif
 
       
+      end
+
+c***********************************************************************
+c Diagonal of A in the block, dg=f+exp(u), set once per solve.
+      subroutine diagmpi(ni,nj,nk,Li,Lj,u,f,dg)
+
+      real u(Li,Lj,nk),f(Li,nj),dg(Li,Lj,nk)
+
+      do k=2,nk-1
+         do j=2,nj-1
+            do i=2,ni-1
+               dg(i,j,k)=f(i,j)+exp(u(i,j,k))
+            enddo
+         enddo
+      enddo
+
       end
 
 c***********************************************************************
 c     Preconditioning subroutine. If Atilde is the preconditioning
 c     matrix, returns z=Atilde^-1*b
-      subroutine asolvempi(ni,nj,nk,Li,Lj,Lk,b,z,u,a,f,g,out)
+      subroutine asolvempi(ni,nj,nk,Li,Lj,Lk,b,z,dg,a,g,out)
 
       
 c      integer ni,nj,nk
 c      integer Li,Lj,Lk
       logical out
-      real b(Li,Lj,nk),z(Li,Lj,nk),u(Li,Lj,nk)
-      real a(ni),f(Li,nj),g(Lj,Lk,5)
+      real b(Li,Lj,nk),z(Li,Lj,nk),dg(Li,Lj,nk)
+      real a(ni),g(Lj,Lk,5)
 
 c Matrix multiplication
       
@@ -635,7 +1115,7 @@ c Matrix multiplication
       do k=2,nk-1
          do j=2,nj-1
             do i=2,ni-1
-               z(i,j,k)=b(i,j,k)/(-f(i,j)-exp(u(i,j,k)))
+               z(i,j,k)=-b(i,j,k)/dg(i,j,k)
             enddo
          enddo
       enddo
@@ -645,13 +1125,13 @@ c Outer boundary
       if(out) then
          do k=2,nk-1               
             do j=2,nj-1
-               z(i,j,k)=b(i,j,k)/(-f(i,j)-exp(u(i,j,k))+a(i)*g(j,k,5)) 
+               z(i,j,k)=-b(i,j,k)/(dg(i,j,k)-a(i)*g(j,k,5))
             enddo
          enddo
       else
          do k=2,nk-1
             do j=2,nj-1
-               z(i,j,k)=b(i,j,k)/(-f(i,j)-exp(u(i,j,k)))     
+               z(i,j,k)=-b(i,j,k)/dg(i,j,k)
             enddo
          enddo
       endif
@@ -660,6 +1140,24 @@ c Outer boundary
 
 
 
+c***********************************************************************
+c Reduction operator of the pipelined solver, on elements of 5 reals:
+c the first four are summed, the fifth is a maximum. itype is the MPI
+c datatype of an element, the 5 contiguous reals icgtype.
+      subroutine cgpipeop(a,b,n,itype)
+      include 'mpif.h'
+      integer n,itype
+      real a(5,n),b(5,n)
+
+      if(itype.eq.MPI_DATATYPE_NULL)return
+      do i=1,n
+         do l=1,4
+            b(l,i)=a(l,i)+b(l,i)
+         enddo
+         b(5,i)=max(a(5,i),b(5,i))
+      enddo
+
+      end
 c***********************************************************************
 c The challenge here is to ensure that all processes decide to end
 c at the same time. If not then a process will hang waiting for message.
@@ -691,7 +1189,12 @@ c Loki's version of mpich seems not to like MPI_IN_PLACE
 c***********************************************************************
 c Cut here and throw the rest away for the basic routines
 c***********************************************************************
-      subroutine fcalc3Dpar(Li,Lj,Lk,ni,nj,nk,mi,eps,k,cg_comm,myid2)
+      subroutine fcalc3Dpar(Li,Lj,Lk,ni,nj,nk,mi,eps,k,cg_comm,myid2,
+     $     rtol,fres,dphi)
+
+c     rtol: skip the solve if the initial residual is below it.
+c     fres returns that residual, dphi the largest change of phi
+c     (on myid2=0 only).
 
 
       include 'piccom.f'
@@ -702,27 +1205,55 @@ c***********************************************************************
       integer nd
       parameter (nd=3,nd2=nd*2)
 
-      real cg_eps,cg_del,eps
+      real cg_eps,cg_del,eps,cg_rtol,cg_res,rtol,fres,dphi
       integer icg_k,icg_mi,mi
       
 
-      common /cg3dctl/icg_mi,cg_eps,cg_del,icg_k
+      common /cg3dctl/icg_mi,cg_eps,cg_del,icg_k,cg_rtol,cg_res
 
-      real b(0:nrsize,0:nthsize,0:npsisize),x(0:nrsize,0:nthsize
-     $     ,0:npsisize),p(0:nrsize,0:nthsize,0:npsisize),res(0:nrsize
-     $     ,0:nthsize ,0:npsisize),z(0:nrsize,0:nthsize,0:npsisize)
-     $     ,pp(0:nrsize,0:nthsize ,0:npsisize),resr(0:nrsize,0:nthsize
-     $     ,0:npsisize),zz(0:nrsize ,0:nthsize,0:npsisize)
+c     Work arrays, all (0:nrsize,0:nthsize,0:npsisize) and kept
+c     between calls
+      real, allocatable :: b(:,:,:),x(:,:,:),p(:,:,:),res(:,:,:)
+     $     ,z(:,:,:),pp(:,:,:),resr(:,:,:),zz(:,:,:),dg(:,:,:)
+c     Workspace of the pipelined solver, 10 of them
+      real, allocatable :: wk(:,:,:,:)
 
 c     Variables used for calculating matrix A for debugging
-      real inputvect(0:nrsize,0:nthsize,0:npsisize),
-     $  outputvect(0:nrsize,0:nthsize,0:npsisize)
+      real, allocatable :: inputvect(:,:,:),outputvect(:,:,:)
       integer n1,n2,n3,j,k,l,m,n,o,jkl,mno
+      save b,x,p,res,z,pp,resr,zz,dg,wk,inputvect,outputvect
 
 
 c testing arrays
       integer iuds(nd),ifull(nd)
 
+      if(.not.allocated(b))then
+         allocate(b(0:nrsize,0:nthsize,0:npsisize)
+     $        ,x(0:nrsize,0:nthsize,0:npsisize)
+     $        ,p(0:nrsize,0:nthsize,0:npsisize)
+     $        ,res(0:nrsize,0:nthsize,0:npsisize)
+     $        ,z(0:nrsize,0:nthsize,0:npsisize)
+     $        ,pp(0:nrsize,0:nthsize,0:npsisize)
+     $        ,resr(0:nrsize,0:nthsize,0:npsisize)
+     $        ,zz(0:nrsize,0:nthsize,0:npsisize)
+     $        ,dg(0:nrsize,0:nthsize,0:npsisize)
+     $        ,wk(0:nrsize,0:nthsize,0:npsisize,10)
+     $        ,inputvect(0:nrsize,0:nthsize,0:npsisize)
+     $        ,outputvect(0:nrsize,0:nthsize,0:npsisize))
+         b=0.
+         x=0.
+         p=0.
+         res=0.
+         z=0.
+         pp=0.
+         resr=0.
+         zz=0.
+         dg=0.
+         wk=0.
+         inputvect=0.
+         outputvect=0.
+      endif
+
 c     Initialize variables for debugging
       lAdebug = .false.
 
@@ -730,6 +1261,7 @@ c     Initialize variables for debugging
       icg_mi=mi
       cg_jac=jac
       cg_eps=eps
+      cg_rtol=rtol
 
 
       ifull(1)=Li
@@ -742,12 +1274,12 @@ c     Initialize variables for debugging
       
       ictl=1
   
-      call cg3dmpi(cg_comm,Li,Lj,Lk,ni,nj,nk,bcphi, phi(1,0,0)
-     $     ,rho(1,0,0),ictl,ierr,myid,idim1,idim2,idim3,apc(1),bpc(1)
-     $     ,cpc(1,0),dpc(1,0),epc(1,0),fpc(1,0),gpc(0,0,1)
+      call cg3dmpi(cg_comm,Li,Lj,Lk,ni,nj,nk,bcphi,phi
+     $     ,rho,ictl,ierr,myid,idim1,idim2,idim3,apc,bpc
+     $     ,cpc,dpc,epc,fpc,gpc
      $     ,b(1,0,0),x(1,0,0)
      $     ,p(1,0,0) ,res(1,0,0),z(1,0,0) ,pp(1,0,0),resr(1,0,0) ,zz(1,0
-     $     ,0),lbcg)
+     $     ,0),dg(1,0,0),lbcg,wk(1,0,0,1),lpipecg)
 
       
       
@@ -787,11 +1319,12 @@ c                   are offset by one element so that when they are
 c                   passed from within that routine as x(0) it is the
 c                   actual beginning of the array that is passed.
                   call cg3dmpi(cg_comm,Li,Lj,Lk,ni,nj,nk,bcphi
-     $              ,phi(1,0,0),rho(1,0,0),ictl,ierr,myid,idim1,idim2
-     $              ,idim3,apc(1),bpc(1),cpc(1,0),dpc(1,0),epc(1,0)
-     $              ,fpc(1,0),gpc(0,0,1),b(1,0,0)
+     $              ,phi,rho,ictl,ierr,myid,idim1,idim2
+     $              ,idim3,apc,bpc,cpc,dpc,epc
+     $              ,fpc,gpc,b(1,0,0)
      $              ,inputvect(1,0,0),p(1,0,0),outputvect(1,0,0)
-     $              ,z(1,0,0),pp(1,0,0),resr(1,0,0),zz(1,0,0),lbcg)
+     $              ,z(1,0,0),pp(1,0,0),resr(1,0,0),zz(1,0,0),dg(1,0,0)
+     $              ,lbcg,wk(1,0,0,1),lpipecg)
                   do m=1,n3
                      do n=1,n2
                         do o=1,n1
@@ -807,11 +1340,12 @@ c                 Pass unit vectors to atimes to build A'
                   inputvect(l,k,j) = 1.
                   lAtranspose = .true.
                   call cg3dmpi(cg_comm,Li,Lj,Lk,ni,nj,nk,bcphi
-     $              ,phi(1,0,0),rho(1,0,0),ictl,ierr,myid,idim1,idim2
-     $              ,idim3,apc(1),bpc(1),cpc(1,0),dpc(1,0),epc(1,0)
-     $              ,fpc(1,0),gpc(0,0,1),b(1,0,0)
+     $              ,phi,rho,ictl,ierr,myid,idim1,idim2
+     $              ,idim3,apc,bpc,cpc,dpc,epc
+     $              ,fpc,gpc,b(1,0,0)
      $              ,inputvect(1,0,0),p(1,0,0),outputvect(1,0,0)
-     $              ,z(1,0,0),pp(1,0,0),resr(1,0,0),zz(1,0,0),lbcg)
+     $              ,z(1,0,0),pp(1,0,0),resr(1,0,0),zz(1,0,0),dg(1,0,0)
+     $              ,lbcg,wk(1,0,0,1),lpipecg)
                   do m=1,n3
                      do n=1,n2
                         do o=1,n1
@@ -829,10 +1363,13 @@ c                          reset output to to be safe
       endif
 
 c Write x, the temporary potential file, to phi, and find maxchange
+      fres=cg_res
+      dphi=0.
       if(myid2.eq.0) then
          do k=1,npsiused
             do j=1,nthused
                do i=2,ni-1
+                  dphi=max(dphi,abs(x(i,j,k)-phi(i,j,k)))
                   phi(i,j,k)=x(i,j,k)
                enddo
             enddo
@@ -5,6 +5,27 @@ c Common data:
       include 'errcom.f'
 
 c      ninner=0
+      call chargezero()
+
+c Perhaps this needs to be larger than npart for .not.lfixed.
+c      write(*,*)'Starting chargetomesh',npart
+      do i=1,iocprev
+         if(ipf(i).gt.0)then
+c         if(i.lt.10000)write(*,'(i6,$)')i
+            call chargepart(i)
+         endif
+      enddo
+
+c      do iw=1,nrused
+c         write(*,*) iw
+c         write(*,*) ((vrsum(iw,jw,kw),jw=1,nthused),kw=1 ,npsiused)
+c      enddo
+      end
+c***********************************************************************
+c Zero the charge and moment sums before a deposit.
+      subroutine chargezero()
+c Common data:
+      include 'piccom.f'
 
 c     Zeroing the arrays take time if we zero everything all the
 c     time. Just zero what needed. Cycle k,j,i rather than i,j,k for
@@ -59,33 +80,33 @@ c Split the zeroying when diags is on, maybe faster with cache ??
          enddo
       endif
 
-c Perhaps this needs to be larger than npart for .not.lfixed.
-c      write(*,*)'Starting chargetomesh',npart
-      do i=1,iocprev
-         if(ipf(i).gt.0)then
-c         if(i.lt.10000)write(*,'(i6,$)')i
-c Use fast ptomesh, half-quantities not needed.
-            ih=0
-            hf=99.
-           
-            call ptomesh(i,irl,rf,ithl,thf,ipl,pf,st,ct,sp,cp,rp
-     $           ,zetap,ih,hf)
-            if(rf.lt.0..or.rf.gt.1.)then
-               rp=sqrt(xp(1,i)**2+xp(2,i)**2+xp(3,i)**2)
-               write(*,*)'Outside mesh, rf error in chargetomesh',
-     $              rf,irl,i,rp
-            else
-               call chargeassign(i,irl,rf,ithl,thf,
-     $              ipl,pf,st,ct,sp,cp,rp)
+      end
+c***********************************************************************
+c Locate particle i on the mesh and deposit its charge (and moments).
+c In fused mode this is called at the end of the particle's advance.
+c The next advance locates it again at the same position, as keeping
+c the cell and fractions of every particle would cost more memory
+c traffic than the ptomesh call saves.
+      subroutine chargepart(i)
+      integer i
+c Common data:
+      include 'piccom.f'
 
-            endif
-         endif
-      enddo
+c Use fast ptomesh, half-quantities not needed.
+      ih=0
+      hf=99.
+
+      call ptomesh(i,irl,rf,ithl,thf,ipl,pf,st,ct,sp,cp,rp
+     $     ,zetap,ih,hf)
+      if(rf.lt.0..or.rf.gt.1.)then
+         rp=sqrt(xp(1,i)**2+xp(2,i)**2+xp(3,i)**2)
+         write(*,*)'Outside mesh, rf error in chargetomesh',
+     $        rf,irl,i,rp
+      else
+         call chargeassign(i,irl,rf,ithl,thf,
+     $        ipl,pf,st,ct,sp,cp,rp)
 
-c      do iw=1,nrused
-c         write(*,*) iw
-c         write(*,*) ((vrsum(iw,jw,kw),jw=1,nthused),kw=1 ,npsiused)
-c      enddo
+      endif
       end
 c***********************************************************************
 c Accumulate particle charge into rho mesh and other diagnostics.
@@ -367,18 +388,15 @@ c Calculate potential phi from rho.
 c Common data:
       include 'piccom.f'
       include 'errcom.f'
-      real phi0mphi1(0:nthsize,0:npsisize),delphi0(0:nthsize,0:npsisize)
-      parameter (nthp1=nthsize+1)
-      parameter (npsip1=npsisize+1)
-      parameter (ntot=nthp1*npsip1)
+c phi0mphi1, delphi0 (0:nthsize,0:npsisize), cs (nthsize,npsisize)
+c and the *sum_r (2,nthsize,npsisize) are kept from step to step.
+      real, allocatable :: phi0mphi1(:,:),delphi0(:,:),cs(:,:)
+      real, allocatable :: psum_r(:,:,:),vrsum_r(:,:,:),vr2sum_r(:,:,:)
 c      real phi1ave
       real bcifac,bcpfac,bci,bcp,bvf
       real relax
-      real cs(nthsize,npsisize),csd(nthsize,npsisize)
+      real csd(nthsize,npsisize)
       real vs,vsd(nthsize,npsisize)
-      real psum_r(2,nthsize,npsisize)
-      real vrsum_r(2,nthsize,npsisize)
-      real vr2sum_r(2,nthsize,npsisize)
       real ncs
       logical first
       integer kk1,kk2
@@ -387,12 +405,22 @@ c Reduced with respect to 2D
       data bcifac/.05/bcpfac/.025/
       data bvf/1.2071/
       data first/.true./
-      data phi0mphi1/ntot*0./
-      data delphi0/ntot*0./
       data ncs/50./
       real dr
       save
       cerr=0.
+      if(.not.allocated(cs))then
+         allocate(phi0mphi1(0:nthsize,0:npsisize)
+     $        ,delphi0(0:nthsize,0:npsisize),cs(nthsize,npsisize))
+         allocate(psum_r(2,nthsize,npsisize),vrsum_r(2,nthsize,npsisize)
+     $        ,vr2sum_r(2,nthsize,npsisize))
+         phi0mphi1=0.
+         delphi0=0.
+         cs=0.
+         psum_r=0.
+         vrsum_r=0.
+         vr2sum_r=0.
+      endif
 
       dr=rcc(2)-rcc(1)
 
@@ -673,6 +701,8 @@ c Radial, Theta and Phi accelerations
       real phih1tX,phih1pX,phih1mX,phih12X
 
       real sinhere,sinplus
+      integer m
+      real u,w,g1,g2,g3,g4
 
       data dp/0./
 
@@ -685,9 +715,62 @@ c Don't use parameter statements. Just set values first time
          dthinv=(nth-1)/pi
       endif
 
-      rl=r(ih)
       ir=ih+1
       ilm1=ih-1
+      if(lecache)then
+c Interpolate the cached gradients with the same weights as below.
+         tflin=(acos(ct)-thang(ith))/(thang(ith+1)-thang(ith))
+         iplp1=mod(ipl,npsiused)+1
+         g1=ercache(ih-1,ith,ipl)*(1.-hf)+ercache(ih,ith,ipl)*hf
+         g2=ercache(ih-1,ith+1,ipl)*(1.-hf)+ercache(ih,ith+1,ipl)*hf
+         g3=ercache(ih-1,ith,iplp1)*(1.-hf)+ercache(ih,ith,iplp1)*hf
+         g4=ercache(ih-1,ith+1,iplp1)*(1.-hf)
+     $        +ercache(ih,ith+1,iplp1)*hf
+         ar=(g1*(1.-tflin)+g2*tflin)*(1.-pf)
+     $        +(g3*(1.-tflin)+g4*tflin)*pf
+         if(debyelen.lt.1.e-2)then
+            if(zetap.le.1.e-2)zetap=1.e-2
+            ar=ar/zetap
+         endif
+         ar=-ar
+
+         u=2.*tflin
+         if(u.le.1.)then
+            m=2*ith
+            w=u
+         else
+            m=2*ith+1
+            w=u-1.
+         endif
+         g1=etcache(ih,m,ipl)*(1.-w)+etcache(ih,m+1,ipl)*w
+         g2=etcache(ih+1,m,ipl)*(1.-w)+etcache(ih+1,m+1,ipl)*w
+         g3=etcache(ih,m,iplp1)*(1.-w)+etcache(ih,m+1,iplp1)*w
+         g4=etcache(ih+1,m,iplp1)*(1.-w)+etcache(ih+1,m+1,iplp1)*w
+         at=(g1*(1.-rf)+g2*rf)*(1.-pf)+(g3*(1.-rf)+g4*rf)*pf
+         at=-at
+         if(lat0)at=0.
+
+         u=2.*pf
+         if(u.le.1.)then
+            m=2*ipl
+            w=u
+         else
+            m=2*ipl+1
+            w=u-1.
+         endif
+         g1=epcache(ih,ith,m)*(1.-w)+epcache(ih,ith,m+1)*w
+         g2=epcache(ih,ith+1,m)*(1.-w)+epcache(ih,ith+1,m+1)*w
+         g3=epcache(ih+1,ith,m)*(1.-w)+epcache(ih+1,ith,m+1)*w
+         g4=epcache(ih+1,ith+1,m)*(1.-w)+epcache(ih+1,ith+1,m+1)*w
+         ap=(g1*(1.-tflin)+g2*tflin)*(1.-rf)
+     $        +(g3*(1.-tflin)+g4*tflin)*rf
+         dpsi=pcc(2)-pcc(1)
+         ap=-ap/(st*dpsi+1e-7)
+         if(lap0)ap=0.
+         goto 502
+      endif
+
+      rl=r(ih)
 c      if(hf.gt.1. .or. hf.lt.0.)write(*,*)'hf=',hf
 
 c     Theta indexes
@@ -926,7 +1009,7 @@ c     sign is because E=-grad(phi)
 
 
 c 3D acceleration
-      accel(3)=ar*ct - at*st
+ 502  accel(3)=ar*ct - at*st
       accel(2)=(ar*st+ at*ct)*sp+ap*cp
       accel(1)=(ar*st+ at*ct)*cp-ap*sp
 c Trap errors.
@@ -951,23 +1034,92 @@ c         stop
 
       end
 c***********************************************************************
+c Fill the field cache /ecache/ from phi, for use by getaccel. These are
+c the same finite differences that getaccel takes per particle, done once
+c per mesh point. Call after every change of phi.
+      subroutine efieldcache()
+      include 'piccom.f'
+      real phik(0:nthsize,0:npsisize)
+
+      do k=1,nr+1
+c Potential and radius at radial index k. Beyond the outer edge use
+c constant slope, as getaccel does.
+         if(k.le.nr)then
+            rk=r(k)
+            do l=0,npsiused+1
+               do j=0,nth+1
+                  phik(j,l)=phi(k,j,l)
+               enddo
+            enddo
+         else
+            rk=2*r(nr)-r(nr-1)
+            do l=0,npsiused+1
+               do j=0,nth+1
+                  phik(j,l)=2*phi(nr,j,l)-phi(nr-1,j,l)
+               enddo
+            enddo
+         endif
+         do l=1,npsiused
+            lp=mod(l,npsiused)+1
+            lm=mod(l+npsiused-2,npsiused)+1
+            do j=1,nth
+c Theta: centered at the nodes, one-sided at the half points.
+               etcache(k,2*j,l)=(phik(j+1,l)-phik(j-1,l))
+     $              /(rk*(thang(j+1)-thang(j-1)))
+               if(j.lt.nth)etcache(k,2*j+1,l)=(phik(j+1,l)-phik(j,l))
+     $              /(rk*(thang(j+1)-thang(j)))
+c Psi, likewise. Psi spacing is divided out in getaccel.
+               epcache(k,j,2*l)=0.5*(phik(j,lp)-phik(j,lm))/rk
+               epcache(k,j,2*l+1)=(phik(j,lp)-phik(j,l))/rk
+            enddo
+         enddo
+         do j=1,nth
+            epcache(k,j,2*npsiused+2)=epcache(k,j,2)
+         enddo
+      enddo
 
+c Radial differences at the half points, in zeta or r as in getaccel.
+c The inner one mirrors phi(2) about phi(1) in the zeta form.
+      do l=1,npsiused
+         do j=1,nth
+            if(debyelen.lt.1.e-2)then
+               ercache(0,j,l)=(phi(2,j,l)-phi(1,j,l))/(zeta(1)-zeta(0))
+               do k=1,nr-1
+                  ercache(k,j,l)=(phi(k+1,j,l)-phi(k,j,l))
+     $                 /(zeta(k+1)-zeta(k))
+               enddo
+               ercache(nr,j,l)=(phi(nr,j,l)-phi(nr-1,j,l))
+     $              /(zeta(nr+1)-zeta(nr))
+            else
+               do k=0,nr-1
+                  ercache(k,j,l)=(phi(k+1,j,l)-phi(k,j,l))
+     $                 /(r(k+1)-r(k))
+               enddo
+               ercache(nr,j,l)=(phi(nr,j,l)-phi(nr-1,j,l))
+     $              /(r(nr)-r(nr-1))
+            endif
+         enddo
+      enddo
+
+      end
 c**********************************************************************
       subroutine esforce(ir,qp,fz,epz,fbz,fx,epx,fbx,fy,epy,fby)
       include 'piccom.f'
       include 'errcom.f'
 c 3D version of esforce
 c Return the charge qp, esforce fz,x,y , and electron pressure force epz,x,y.
+c These are summed over the psi slab of this process only, and need to
+c be summed over the processes. The Lorentz force fbz,x,y is complete
+c where curr has been reduced.
 
 
-c Coefficients for fz      
-      real ercoefZ(nthsize),etcoefZ(nthsize),epcoefZ(nthsize)
-     $     ,ertcoefZ(nthsize)
+c Coefficients for fz, all (nthsize)
+      real, allocatable :: ercoefZ(:),etcoefZ(:),epcoefZ(:),ertcoefZ(:)
 c Coefficients for fx,y
-      real ercoefX(nthsize),etcoefX(nthsize),epcoefX(nthsize)
-     $     ,ertcoefX(nthsize) ,erpcoefX(nthsize)
+      real, allocatable :: ercoefX(:),etcoefX(:),epcoefX(:)
+     $     ,ertcoefX(:),erpcoefX(:)
 c Coefficients for the charge qp
-      real qpcoef(nthsize)
+      real, allocatable :: qpcoef(:)
 
 c Psi angular spacing
       real dpsi
@@ -985,6 +1137,10 @@ c sin theta between four cell centers, interpolated in theta and not cos(theta)
       dpsi=pcc(2)-pcc(1)
 
       if(lnotinit)then
+         allocate(ercoefZ(nthsize),etcoefZ(nthsize),epcoefZ(nthsize)
+     $        ,ertcoefZ(nthsize),ercoefX(nthsize),etcoefX(nthsize)
+     $        ,epcoefX(nthsize),ertcoefX(nthsize),erpcoefX(nthsize)
+     $        ,qpcoef(nthsize))
 c Initialize coefficient arrays
          do j=1,nthused-1
         
@@ -1063,7 +1219,7 @@ c We do this at a specified radius node.
       fx=0
       fy=0.
 
-      do l=1,npsiused
+      do l=kpsi1,kpsi2
          sp=sin(pcc(l))
          cp=cos(pcc(l))
          spp=sin(pcc(l+1))
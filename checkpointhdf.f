@@ -0,0 +1,461 @@
+c*********************************************************************
+c Checkpoint in the single shared file part.h5, written and read by
+c all the processes together through parallel HDF5 and collective
+c MPI-IO, instead of the files partNNN.dat of partwrt and partrd.
+c The particle slots of the processes are laid end to end, in the
+c order of the processes, in the datasets xp(ndim,ntot), dtprec(ntot),
+c vzinit(ntot) and ipf(ntot); nslot(numprocs) gives the number of slots
+c of each. istate and rstate hold a column per process of its random
+c number state and velocity diagnostics. The state common to all the
+c processes is written by process 0, one dataset per array.
+c A new checkpoint is written as part.h5.tmp, and renamed once complete
+c after the previous nckkeep have been shifted to part.h5.1 and so on.
+c*********************************************************************
+      subroutine partwrthdf(istep,time,ninjcomp0)
+c Load the hdf5 module
+      use hdf5
+c Don't allow implicit definitions
+      implicit none
+c Input variables
+      integer istep,ninjcomp0
+      real time
+c Common data
+      include 'piccom.f'
+      include 'mpif.h'
+c Local variables
+      INTEGER(HID_T) :: file_id
+      integer ierr,id,n,n0,ntot,ioff
+      integer iheader(6),iscal(5),istate(5)
+      real rscal(7),rstate(99+3*nvmax)
+      integer, allocatable :: nslot(:)
+
+c Every process needs the slot counts of all to place its own.
+      allocate(nslot(0:numprocs-1))
+      call MPI_ALLGATHER(iocprev,1,MPI_INTEGER,nslot,1,MPI_INTEGER,
+     $     MPI_COMM_WORLD,ierr)
+      ntot=0
+      do id=0,numprocs-1
+         if(id.eq.myid)ioff=ntot
+         ntot=ntot+nslot(id)
+      enddo
+      n=iocprev
+c Process 0 alone writes what is common; the others select nothing.
+      n0=0
+      if(myid.eq.0)n0=1
+
+      call ckhdfopen(file_id,'part.h5.tmp',.true.,ierr)
+      if(ierr.ne.0)then
+         if(myid.eq.0)write(*,*)'Could not create part.h5.tmp'
+         return
+      endif
+      iheader(1)=ickvers
+      iheader(2)=numprocs
+      iheader(3)=nr
+      iheader(4)=nth
+      iheader(5)=npsi
+      iheader(6)=istep
+      call ckhdfint(file_id,'header',iheader,6,n0,0,1,.true.)
+      call ckhdfint(file_id,'nslot',nslot,numprocs,n0,0,1,.true.)
+
+      call ranstate(.false.,istate,rstate)
+      istate(5)=0
+      rstate(100:99+nvmax)=nvdiag
+      rstate(100+nvmax:99+2*nvmax)=vrdiagin
+      rstate(100+2*nvmax:99+3*nvmax)=vtdiagin
+      call ckhdfint(file_id,'istate',istate,5,1,myid,numprocs,.true.)
+      call ckhdfreal(file_id,'rstate',rstate,99+3*nvmax,1,myid,
+     $     numprocs,.true.)
+
+      call ckhdfreal(file_id,'xp',xp,ndim,n,ioff,ntot,.true.)
+      call ckhdfreal(file_id,'dtprec',dtprec,1,n,ioff,ntot,.true.)
+      call ckhdfreal(file_id,'vzinit',vzinit,1,n,ioff,ntot,.true.)
+      call ckhdfint(file_id,'ipf',ipf,1,n,ioff,ntot,.true.)
+
+      rscal(1)=time
+      rscal(2)=rhoinf
+      rscal(3)=spotrein
+      rscal(4)=averein
+      rscal(5)=adeficit
+      rscal(6)=vprobe
+      rscal(7)=fluxrein
+      iscal(1)=ninjcomp0
+      iscal(2)=nstepsave
+      iscal(3)=nrein
+      iscal(4)=nreintry
+      iscal(5)=ninner
+      call ckhdfreal(file_id,'scalars',rscal,7,n0,0,1,.true.)
+      call ckhdfint(file_id,'iscalars',iscal,5,n0,0,1,.true.)
+      call ckcommonhdf(file_id,n0,istep,.true.)
+
+      call h5fclose_f(file_id,ierr)
+      call h5close_f(ierr)
+      if(myid.eq.0)then
+         call ckrename('part.h5',nckkeep)
+         write(*,*)'Checkpoint at step',istep,
+     $        ' rhoinf,spotrein,averein',rhoinf,spotrein,averein
+      endif
+      end
+
+c*********************************************************************
+c Restart from part.h5: the parallel counterpart of partrd. Every
+c process reads the header and the slot counts, so that they all take
+c the same decisions, and no process leaves the collective reads early.
+      subroutine partrdhdf(success,istep,time,ninjcomp0)
+c Load the hdf5 module
+      use hdf5
+c Don't allow implicit definitions
+      implicit none
+c Input variables
+      logical success
+      integer istep,ninjcomp0
+      real time
+c Common data
+      include 'piccom.f'
+      include 'mpif.h'
+c Local variables
+      INTEGER(HID_T) :: file_id
+      integer ierr,i,id,n,m,nprocs,is0,ninjc,ioff,nmax
+      integer iheader(6),iscal(5),istate(5)
+      integer*8 ntot,i1,i2
+      real rscal(7),rstate(99+3*nvmax)
+      integer, allocatable :: nslot(:)
+
+      success=.false.
+      call ckhdfopen(file_id,'part.h5',.false.,ierr)
+      if(ierr.ne.0)then
+         if(myid.eq.0)write(*,*)'No checkpoint file part.h5'
+         return
+      endif
+      call ckhdfint(file_id,'header',iheader,6,1,0,1,.false.)
+      nprocs=iheader(2)
+      is0=iheader(6)
+      if(iheader(1).ne.ickvers)then
+         if(myid.eq.0)write(*,*)
+     $        'part.h5 is not a checkpoint of version',ickvers
+         goto 100
+      elseif(iheader(3).ne.nr .or. iheader(4).ne.nth
+     $        .or. iheader(5).ne.npsi)then
+         if(myid.eq.0)write(*,*)'Checkpoint mesh mismatch',
+     $        iheader(3),nr,iheader(4),nth,iheader(5),npsi
+         goto 100
+      elseif(is0.ge.maxsteps)then
+         if(myid.eq.0)write(*,*)'Checkpoint is at step',is0,
+     $        '  of',maxsteps
+         goto 100
+      endif
+      allocate(nslot(0:nprocs-1))
+      call ckhdfint(file_id,'nslot',nslot,nprocs,1,0,1,.false.)
+      ntot=0
+      do id=0,nprocs-1
+         if(id.eq.myid)ioff=int(ntot)
+         ntot=ntot+nslot(id)
+      enddo
+
+      if(nprocs.eq.numprocs)then
+c Same processes: this one's own slots and random numbers.
+         nmax=maxval(nslot)
+         if(nmax.gt.npartmax)goto 102
+         n=nslot(myid)
+         call ckhdfint(file_id,'istate',istate,5,1,myid,numprocs,
+     $        .false.)
+         call ckhdfreal(file_id,'rstate',rstate,99+3*nvmax,1,myid,
+     $        numprocs,.false.)
+         call ranstate(.true.,istate,rstate)
+         nvdiag=rstate(100:99+nvmax)
+         vrdiagin=rstate(100+nvmax:99+2*nvmax)
+         vtdiagin=rstate(100+2*nvmax:99+3*nvmax)
+      else
+c Take slots i1+1 to i2 of all the slots in order.
+         nmax=0
+         do id=0,numprocs-1
+            nmax=max(nmax,int((ntot*(id+1))/numprocs
+     $           -(ntot*id)/numprocs))
+         enddo
+         if(nmax.gt.npartmax)goto 102
+         i1=(ntot*myid)/numprocs
+         i2=(ntot*(myid+1))/numprocs
+         ioff=int(i1)
+         n=int(i2-i1)
+      endif
+      call ckhdfreal(file_id,'xp',xp,ndim,n,ioff,int(ntot),.false.)
+      call ckhdfreal(file_id,'dtprec',dtprec,1,n,ioff,int(ntot),
+     $     .false.)
+      call ckhdfreal(file_id,'vzinit',vzinit,1,n,ioff,int(ntot),
+     $     .false.)
+      call ckhdfint(file_id,'ipf',ipf,1,n,ioff,int(ntot),.false.)
+      if(nprocs.ne.numprocs)then
+c Drop the empty slots.
+         m=0
+         do i=1,n
+            if(ipf(i).gt.0)then
+               m=m+1
+               xp(:,m)=xp(:,i)
+               dtprec(m)=dtprec(i)
+               vzinit(m)=vzinit(i)
+               ipf(m)=ipf(i)
+            endif
+         enddo
+         n=m
+         if(lfixedn .and. n.ne.npart)then
+            write(*,*)'Process',myid,' has',n,' particles, not',npart
+            npart=n
+         endif
+      endif
+      do i=n+1,npartmax
+         ipf(i)=0
+      enddo
+      iocprev=n
+
+c Every process reads the common state.
+      call ckhdfreal(file_id,'scalars',rscal,7,1,0,1,.false.)
+      call ckhdfint(file_id,'iscalars',iscal,5,1,0,1,.false.)
+      time=rscal(1)
+      rhoinf=rscal(2)
+      spotrein=rscal(3)
+      averein=rscal(4)
+      adeficit=rscal(5)
+      vprobe=rscal(6)
+      fluxrein=rscal(7)
+      ninjc=iscal(1)
+      nstepsave=iscal(2)
+      nrein=iscal(3)
+      nreintry=iscal(4)
+      ninner=iscal(5)
+      call ckcommonhdf(file_id,1,is0,.false.)
+      call h5fclose_f(file_id,ierr)
+      call h5close_f(ierr)
+c The injections per step were those of the checkpoint's processes.
+      if(.not.lfixedn)ninjcomp0=int((int(ninjc,8)*nprocs)/numprocs)
+      istep=is0
+      if(myid.eq.0)write(*,*)'Restart at step',istep,
+     $     ' rhoinf,spotrein,averein',rhoinf,spotrein,averein
+      success=.true.
+      return
+ 102  if(myid.eq.0)write(*,*)'Too many particles for npartmax',
+     $     npartmax
+ 100  call h5fclose_f(file_id,ierr)
+      call h5close_f(ierr)
+      end
+
+c*********************************************************************
+c Write (lwrite) or read the arrays common to all the processes, those
+c of the step histories up to istep. n is 1 on the processes that
+c transfer them, 0 on the others.
+      subroutine ckcommonhdf(file_id,n,istep,lwrite)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: file_id
+      integer n,istep
+      logical lwrite
+      include 'piccom.f'
+
+      call ckhdfreal(file_id,'phi',phi,size(phi),n,0,1,lwrite)
+      call ckhdfreal(file_id,'phiaxis',phiaxis,size(phiaxis),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'diagrho',diagrho,size(diagrho),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'diagphi',diagphi,size(diagphi),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'diagchi',diagchi,size(diagchi),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'fincellave',fincellave,size(fincellave)
+     $     ,n,0,1,lwrite)
+      call ckhdfreal(file_id,'vrincellave',vrincellave,
+     $     size(vrincellave),n,0,1,lwrite)
+      call ckhdfreal(file_id,'vr2incellave',vr2incellave,
+     $     size(vr2incellave),n,0,1,lwrite)
+      call ckhdfreal(file_id,'rhoDiag',rhoDiag,size(rhoDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'pDiag',pDiag,size(pDiag),n,0,1,lwrite)
+      call ckhdfreal(file_id,'vrDiag',vrDiag,size(vrDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vtDiag',vtDiag,size(vtDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vpDiag',vpDiag,size(vpDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vr2Diag',vr2Diag,size(vr2Diag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vt2Diag',vt2Diag,size(vt2Diag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vp2Diag',vp2Diag,size(vp2Diag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vrtDiag',vrtDiag,size(vrtDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vrpDiag',vrpDiag,size(vrpDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'vtpDiag',vtpDiag,size(vtpDiag),n,0,1,
+     $     lwrite)
+      call ckhdfreal(file_id,'fluxprobe',fluxprobe(1:istep),istep,
+     $     n,0,1,lwrite)
+      call ckhdfreal(file_id,'enertot',enertot(1:istep),istep,
+     $     n,0,1,lwrite)
+      call ckhdfreal(file_id,'zmom',zmom(1:istep,:,:),
+     $     size(zmom(1:istep,:,:)),n,0,1,lwrite)
+      call ckhdfreal(file_id,'xmom',xmom(1:istep,:,:),
+     $     size(xmom(1:istep,:,:)),n,0,1,lwrite)
+      call ckhdfreal(file_id,'ymom',ymom(1:istep,:,:),
+     $     size(ymom(1:istep,:,:)),n,0,1,lwrite)
+      call ckhdfreal(file_id,'nincellstep',nincellstep(:,:,0:istep),
+     $     size(nincellstep(:,:,0:istep)),n,0,1,lwrite)
+      call ckhdfreal(file_id,'vrincellstep',vrincellstep(:,:,0:istep),
+     $     size(vrincellstep(:,:,0:istep)),n,0,1,lwrite)
+      call ckhdfreal(file_id,'vr2incellstep',
+     $     vr2incellstep(:,:,0:istep),
+     $     size(vr2incellstep(:,:,0:istep)),n,0,1,lwrite)
+      end
+
+c*********************************************************************
+c Create (lcreate) or open the file name for all the processes through
+c the MPI-IO driver. Objects are aligned on 1 MB, the stripe size of
+c most parallel file systems, so that the large collective transfers
+c do not straddle stripes.
+      subroutine ckhdfopen(file_id,name,lcreate,error)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: file_id
+      character*(*) name
+      logical lcreate
+      integer error
+      include 'mpif.h'
+      INTEGER(HID_T) :: plist_id
+      INTEGER(HSIZE_T) :: ialign
+      integer ierr
+
+      ialign=1048576
+      call h5open_f(error)
+      call h5pcreate_f(H5P_FILE_ACCESS_F,plist_id,error)
+      call h5pset_fapl_mpio_f(plist_id,MPI_COMM_WORLD,MPI_INFO_NULL,
+     $     error)
+      call h5pset_alignment_f(plist_id,ialign,ialign,error)
+      if(lcreate)then
+         call h5fcreate_f(name,H5F_ACC_TRUNC_F,file_id,error,
+     $        access_prp=plist_id)
+      else
+c Quietly, since a missing file is reported by the caller.
+         call h5eset_auto_f(0,ierr)
+         call h5fopen_f(name,H5F_ACC_RDONLY_F,file_id,error,
+     $        access_prp=plist_id)
+         call h5eset_auto_f(1,ierr)
+      endif
+      call h5pclose_f(plist_id,ierr)
+      if(error.ne.0)call h5close_f(ierr)
+      end
+
+c*********************************************************************
+c Write (lwrite) or read the real dataset name of shape (m,ntot),
+c collectively: this process transfers the columns ioff+1 to ioff+n
+c from or to a(m,n). Processes with n=0 select nothing but still take
+c part, since every transfer is collective.
+      subroutine ckhdfreal(file_id,name,a,m,n,ioff,ntot,lwrite)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: file_id
+      character*(*) name
+      integer m,n,ioff,ntot
+      real a(*)
+      logical lwrite
+      INTEGER(HID_T) :: dset_id,fspace_id,mspace_id,plist_id
+      INTEGER(HSIZE_T), DIMENSION(2) :: dims,start,count
+      INTEGER(HSIZE_T), DIMENSION(1) :: mdims
+      integer error
+
+      call ckhdfspace(m,n,ioff,ntot,dims,start,count,mdims,
+     $     fspace_id,mspace_id,plist_id)
+      if(lwrite)then
+         call h5dcreate_f(file_id,name,H5T_NATIVE_REAL,fspace_id,
+     $        dset_id,error)
+         call ckhdfselect(n,fspace_id,mspace_id,start,count)
+         call h5dwrite_f(dset_id,H5T_NATIVE_REAL,a,mdims,error,
+     $        mspace_id,fspace_id,plist_id)
+      else
+         call h5dopen_f(file_id,name,dset_id,error)
+         call ckhdfselect(n,fspace_id,mspace_id,start,count)
+         call h5dread_f(dset_id,H5T_NATIVE_REAL,a,mdims,error,
+     $        mspace_id,fspace_id,plist_id)
+      endif
+      call h5dclose_f(dset_id,error)
+      call h5sclose_f(fspace_id,error)
+      call h5sclose_f(mspace_id,error)
+      call h5pclose_f(plist_id,error)
+      end
+
+c*********************************************************************
+c Integer version of ckhdfreal.
+      subroutine ckhdfint(file_id,name,ia,m,n,ioff,ntot,lwrite)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: file_id
+      character*(*) name
+      integer m,n,ioff,ntot
+      integer ia(*)
+      logical lwrite
+      INTEGER(HID_T) :: dset_id,fspace_id,mspace_id,plist_id
+      INTEGER(HSIZE_T), DIMENSION(2) :: dims,start,count
+      INTEGER(HSIZE_T), DIMENSION(1) :: mdims
+      integer error
+
+      call ckhdfspace(m,n,ioff,ntot,dims,start,count,mdims,
+     $     fspace_id,mspace_id,plist_id)
+      if(lwrite)then
+         call h5dcreate_f(file_id,name,H5T_NATIVE_INTEGER,fspace_id,
+     $        dset_id,error)
+         call ckhdfselect(n,fspace_id,mspace_id,start,count)
+         call h5dwrite_f(dset_id,H5T_NATIVE_INTEGER,ia,mdims,error,
+     $        mspace_id,fspace_id,plist_id)
+      else
+         call h5dopen_f(file_id,name,dset_id,error)
+         call ckhdfselect(n,fspace_id,mspace_id,start,count)
+         call h5dread_f(dset_id,H5T_NATIVE_INTEGER,ia,mdims,error,
+     $        mspace_id,fspace_id,plist_id)
+      endif
+      call h5dclose_f(dset_id,error)
+      call h5sclose_f(fspace_id,error)
+      call h5sclose_f(mspace_id,error)
+      call h5pclose_f(plist_id,error)
+      end
+
+c*********************************************************************
+c The file and memory dataspaces and the collective transfer list for
+c columns ioff+1 to ioff+n of an (m,ntot) dataset. Empty extents are
+c given one element, which is then not selected.
+      subroutine ckhdfspace(m,n,ioff,ntot,dims,start,count,mdims,
+     $     fspace_id,mspace_id,plist_id)
+      use hdf5
+      implicit none
+      integer m,n,ioff,ntot
+      INTEGER(HSIZE_T), DIMENSION(2) :: dims,start,count
+      INTEGER(HSIZE_T), DIMENSION(1) :: mdims
+      INTEGER(HID_T) :: fspace_id,mspace_id,plist_id
+      integer error
+
+      dims(1)=m
+      dims(2)=max(ntot,1)
+      start(1)=0
+      start(2)=ioff
+      count(1)=m
+      count(2)=n
+      mdims(1)=max(m*n,1)
+      call h5screate_simple_f(2,dims,fspace_id,error)
+      call h5screate_simple_f(1,mdims,mspace_id,error)
+      call h5pcreate_f(H5P_DATASET_XFER_F,plist_id,error)
+      call h5pset_dxpl_mpio_f(plist_id,H5FD_MPIO_COLLECTIVE_F,error)
+      end
+
+c*********************************************************************
+c Select the hyperslab of this process, or nothing if n is 0.
+      subroutine ckhdfselect(n,fspace_id,mspace_id,start,count)
+      use hdf5
+      implicit none
+      integer n
+      INTEGER(HID_T) :: fspace_id,mspace_id
+      INTEGER(HSIZE_T), DIMENSION(2) :: start,count
+      integer error
+
+      if(n.gt.0)then
+         call h5sselect_hyperslab_f(fspace_id,H5S_SELECT_SET_F,start,
+     $        count,error)
+      else
+         call h5sselect_none_f(fspace_id,error)
+         call h5sselect_none_f(mspace_id,error)
+      endif
+      end
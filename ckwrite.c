@@ -0,0 +1,139 @@
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+/* Staging buffer and writer of the checkpoint files. partwrt copies
+   the whole file into the buffer with ckputr_, ckputi_ and ckputc_,
+   then ckcommit_ writes it out, on a background thread if asked, so
+   that the run goes on meanwhile. A file is written as name.tmp and
+   only renamed to name once complete, after the older ones have been
+   shifted to name.1, name.2 ... keeping nkeep of them. */
+
+static char *ckbuf=NULL;
+static size_t cklen=0, ckcap=0;
+static char ckname[256];
+static int cknkeep=0;
+static pthread_t ckthread;
+static int ckbusy=0;
+
+/* Wait for the write in progress, if any. */
+void ckwait_()
+{
+  if(ckbusy){
+    pthread_join(ckthread,NULL);
+    ckbusy=0;
+  }
+}
+
+/* Start staging a new checkpoint, once the previous one is out. */
+void ckbegin_()
+{
+  ckwait_();
+  cklen=0;
+}
+
+static void ckput(const void *a, size_t n)
+{
+  char *b;
+  size_t cap;
+  if(cklen+n > ckcap){
+    cap = ckcap ? ckcap : 1048576;
+    while(cap < cklen+n) cap*=2;
+    b=realloc(ckbuf,cap);
+    if(!b){
+      fprintf(stderr,"Checkpoint buffer of %lu bytes not allocated\n",
+	      (unsigned long)cap);
+      exit(1);
+    }
+    ckbuf=b;
+    ckcap=cap;
+  }
+  memcpy(ckbuf+cklen,a,n);
+  cklen+=n;
+}
+
+void ckputr_(float *a, int *n)
+{
+  ckput(a,(size_t)*n*sizeof(float));
+}
+
+void ckputi_(int *a, int *n)
+{
+  ckput(a,(size_t)*n*sizeof(int));
+}
+
+/* The hidden length of the Fortran string is not needed. */
+void ckputc_(char *a, int *n)
+{
+  ckput(a,(size_t)*n);
+}
+
+/* Copy the Fortran string name of length lname, less trailing blanks. */
+static void ckfname(char *c, const char *name, size_t lname)
+{
+  while(lname > 0 && name[lname-1]==' ') lname--;
+  if(lname > 255) lname=255;
+  memcpy(c,name,lname);
+  c[lname]='\0';
+}
+
+/* Rotate the older checkpoints and put the new one, name.tmp, in
+   place as name. */
+static void ckrename(const char *name, int nkeep)
+{
+  char old[272], new[272];
+  int k;
+  for(k=nkeep; k>0; k--){
+    if(k>1) snprintf(old,sizeof old,"%s.%d",name,k-1);
+    else snprintf(old,sizeof old,"%s",name);
+    snprintf(new,sizeof new,"%s.%d",name,k);
+    rename(old,new);
+  }
+  snprintf(old,sizeof old,"%s.tmp",name);
+  if(rename(old,name))
+    fprintf(stderr,"Checkpoint %s not renamed to %s\n",old,name);
+}
+
+void ckrename_(char *name, int *nkeep, size_t lname)
+{
+  char c[256];
+  ckfname(c,name,lname);
+  ckrename(c,*nkeep);
+}
+
+static void *ckwrite(void *arg)
+{
+  char tmp[264];
+  FILE *f;
+  snprintf(tmp,sizeof tmp,"%s.tmp",ckname);
+  f=fopen(tmp,"wb");
+  if(!f){
+    fprintf(stderr,"Checkpoint %s not opened\n",tmp);
+    return NULL;
+  }
+  if(fwrite(ckbuf,1,cklen,f)!=cklen){
+    fprintf(stderr,"Error writing checkpoint %s\n",tmp);
+    fclose(f);
+    return NULL;
+  }
+  if(fclose(f)){
+    fprintf(stderr,"Error closing checkpoint %s\n",tmp);
+    return NULL;
+  }
+  ckrename(ckname,cknkeep);
+  return NULL;
+}
+
+/* Write the staged checkpoint to the file name, keeping nkeep older
+   ones; in the background if lasync. */
+void ckcommit_(char *name, int *nkeep, int *lasync, size_t lname)
+{
+  ckfname(ckname,name,lname);
+  cknkeep=*nkeep;
+  if(*lasync && !pthread_create(&ckthread,NULL,ckwrite,NULL)){
+    ckbusy=1;
+  }else{
+    ckwrite(NULL);
+  }
+}
@@ -1,28 +1,19 @@
 
-      subroutine chargediag(dt,istep,icolntype)
-      real dt
-      integer istep,icolntype
+      subroutine chargesums(dsum)
+c Sum over the psi slab of this process the upstream density and
+c potential profiles, the number of cells in them, and the outer
+c potential as a function of theta, into dsum for chargediag.
 c Common data:
       include 'piccom.f'
       include 'errcom.f'
-      include 'fvcom.f'
-      real rhoplot(nrsize),rho1theta(nthsize),rhomidtheta(nthsize)
-      real rhomidave(nthsize),rho1ave(nthsize)
-      real phiave(nrsize)
-      real phitemp
-c      real riave
-      save
-c Calculate rhoplot,diagphi,diagrho,rho1theta,rhomidtheta
-      do i=1,nr
- 510     format(10f8.1)
-         rhoplot(i)=0.
-         phiave(i)=0.
-         nrp=0
-      enddo
+      real dsum(2*nrsize+nthsize+1)
 
+      do i=1,2*nrsize+nthsize+1
+         dsum(i)=0.
+      enddo
 
 c Assume the unperturbed region is upstream outside the magnetic shadow      
-      do k=1,NPSIUSED
+      do k=kpsi1,kpsi2
          do j=1,NTHUSED
 
 c     If (very, i.e. in the first 0.25% of the domain) upstream (the
@@ -36,19 +27,45 @@ c      consider the magnetic shadow to be rcc(nrused)/2)
      $              **2)*sin(pcc(k)))**2+(-sqrt(1-tcc(j)**2) *cos(pcc(k)
      $              )*sqrt(1 -cB**2))**2+(sqrt(1-tcc(j)**2) *cos(pcc(k))
      $              *cB)**2.ge.(0.5)**2)) then
-                  nrp=nrp+1
+                  dsum(2*nrsize+1)=dsum(2*nrsize+1)+1.
                   do i=1,nr
 c     rhoplot is unnormalized. All others are normalized.
-                     rhoplot(i)=rhoplot(i)+rho(i,j,k)
-                     phiave(i)=phiave(i)+phi(i,j,k)
+                     dsum(i)=dsum(i)+rho(i,j,k)
+                     dsum(nrsize+i)=dsum(nrsize+i)+phi(i,j,k)
                   enddo
                endif
             endif
          enddo
       enddo
+
+      do j=1,NTHUSED
+         do k=kpsi1,kpsi2
+            dsum(2*nrsize+1+j)=dsum(2*nrsize+1+j)+phi(NRUSED,j,k)
+         enddo
+      enddo
+
+      end
+c********************************************************************
+      subroutine chargediag(dt,istep,icolntype,dsum)
+      real dt
+      integer istep,icolntype
+c Common data:
+      include 'piccom.f'
+      include 'errcom.f'
+      include 'fvcom.f'
+c Sums of chargesums over all the psi slabs
+      real dsum(2*nrsize+nthsize+1)
+      real rhoplot(nrsize),rho1theta(nthsize),rhomidtheta(nthsize)
+      real rhomidave(nthsize),rho1ave(nthsize)
+      real phiave(nrsize)
+      real phitemp
+c      real riave
+      save
+c Calculate rhoplot,diagphi,diagrho,rho1theta,rhomidtheta
+      nrp=nint(dsum(2*nrsize+1))
       do i=1,nr
-         rhoplot(i)=rhoplot(i)/nrp
-         phiave(i)=phiave(i)/nrp
+         rhoplot(i)=dsum(i)/nrp
+         phiave(i)=dsum(nrsize+i)/nrp
          diagphi(i)=(diagphi(i)*(nstepsave-1)+
      $        phiave(i))/nstepsave
          diagrho(i)=(diagrho(i)*(nstepsave-1) + (rhoplot(i)))/nstepsave
@@ -59,10 +76,7 @@ c to the ion thermal velocity)
 c Necessary for the fortran diagnostics
       phiout=0.
       do j=1,NTHUSED
-         phitemp=0.
-         do k=1,NPSIUSED
-            phitemp=phitemp+phi(NRUSED,j,k)
-         enddo
+         phitemp=dsum(2*nrsize+1+j)
          diagchi(j)=(diagchi(j)*(nstepsave-1)+phitemp/Ti/NPSIUSED)
      $        /nstepsave
          phiout=phiout+phitemp
@@ -143,7 +157,7 @@ c      save
       real rhoave(0:nrsize,0:nthsize)
       logical lfirst
       data lfirst/.true./
-      save xrho,zrho,lfirst,first
+      save lfirst,first
       
       rmi=rhomin
       rma=rhomax
@@ -259,7 +273,7 @@ c      save
       real rhoave(0:nrsize,0:npsisize)
       logical lfirst
       data lfirst/.true./
-      save xrho,yrho,lfirst,first
+      save lfirst,first
       
       nthhalf=nint(0.5*nthused)
       rmi=rhomin
@@ -353,7 +367,7 @@ c Overplot orbits on existing plot.
       call winset(.true.)
       do k=1,norbits
          call color(7)
-         call polyline(zorbit(1,k),rorbit(1,k),iorbitlen(k))
+         call polyline(zorbit(:,k),rorbit(:,k),iorbitlen(k))
          call color(15)
          call charsize(0.01,0.01)
          call accircle(wx2nx(zorbit(iorbitlen(k),k)),
@@ -370,13 +384,15 @@ c Slices, averaged over psi
       include 'piccom.f'
       include 'errcom.f'
       character charin*100,ch2*100
-      real rccleft(nrsize),phip1(nrsize)
+      real, allocatable :: rccleft(:)
+      real phip1(nrsize)
       real rhoave(0:nrsize,0:nthsize),potave(0:nrsize,0:nthsize)
       logical sfirst
       data sfirst/.true./
       save rccleft,sfirst
 
       if(sfirst)then
+         allocate(rccleft(nrsize))
          do j=1,NRUSED
             rccleft(j)=-rcc(j)
          enddo
@@ -440,7 +456,7 @@ c     call polyline(rccleft,rholeft,NRUSED)
          call winset(.true.)
  
          call polyline(rccleft,rhoave(1,NTHUSED-j+1),NRUSED)
-         call polyline(rcc(1),rhoave(1,j),NRUSED)
+         call polyline(rcc(1:NRUSED),rhoave(1,j),NRUSED)
  
          call dashset(2)
          do k=1,NRUSED
@@ -450,7 +466,7 @@ c     call polyline(rccleft,rholeft,NRUSED)
          do k=1,NRUSED
             phip1(k)=phiscale*potave(k,j)+phi0rho
          enddo
-         call polyline(rcc(1),phip1,NRUSED)
+         call polyline(rcc(1:NRUSED),phip1,NRUSED)
          call dashset(0)
          call winset(.false.)
          write(charin,'(f4.0)')thang(j)*180./3.1415927
@@ -516,7 +532,7 @@ c      call boxtitle('Density')
          call color(mod(j,15)+1)
          call winset(.true.)
  
-         call polyline(tcc(1),rhoave(1,j),NTHUSED)
+         call polyline(tcc(1:NTHUSED),rhoave(1,j),NTHUSED)
  
          call winset(.false.)
          write(charin,'(f4.0)')pcc(j)*180./3.1415927
@@ -48,6 +48,171 @@ c     used for pi. Not a problem
       end
 
 
+c***********************************************************************
+c Allocate the arrays of piccom.f for the sizes npartmax, nrsize,
+c nthsize, npsisize and nstepmax set from the command line, and zero
+c them as the static commons they replace were.
+      subroutine picalloc()
+      include 'piccom.f'
+      integer n1,n2,n3
+
+      allocate(xp(ndim,npartmax),vzinit(npartmax),dtprec(npartmax)
+     $     ,ipf(npartmax))
+      xp=0.
+      vzinit=0.
+      dtprec=0.
+      ipf=0
+      allocate(phi(0:nrsize,0:nthsize,0:npsisize)
+     $     ,phiaxis(0:nrsize,2,0:npsisize)
+     $     ,rho(0:nrsize,0:nthsize,0:npsisize)
+     $     ,rhoDiag(0:nrsize,0:nthsize,0:npsisize))
+      phi=0.
+      phiaxis=0.
+      rho=0.
+      rhoDiag=0.
+
+c Moments
+      n1=nrsize-1
+      n2=nthsize-1
+      n3=npsisize-1
+      allocate(psum(n1,n2,n3),vrsum(n1,n2,n3),vtsum(n1,n2,n3)
+     $     ,vpsum(n1,n2,n3),vr2sum(n1,n2,n3),vt2sum(n1,n2,n3)
+     $     ,vp2sum(n1,n2,n3),vrtsum(n1,n2,n3),vrpsum(n1,n2,n3)
+     $     ,vtpsum(n1,n2,n3),vxsum(n1,n2,n3),vysum(n1,n2,n3)
+     $     ,vzsum(n1,n2,n3))
+      allocate(pDiag(n1,n2,n3),vrDiag(n1,n2,n3),vtDiag(n1,n2,n3)
+     $     ,vpDiag(n1,n2,n3),vr2Diag(n1,n2,n3),vt2Diag(n1,n2,n3)
+     $     ,vp2Diag(n1,n2,n3),vrtDiag(n1,n2,n3),vrpDiag(n1,n2,n3)
+     $     ,vtpDiag(n1,n2,n3))
+      psum=0.
+      vrsum=0.
+      vtsum=0.
+      vpsum=0.
+      vr2sum=0.
+      vt2sum=0.
+      vp2sum=0.
+      vrtsum=0.
+      vrpsum=0.
+      vtpsum=0.
+      vxsum=0.
+      vysum=0.
+      vzsum=0.
+      pDiag=0.
+      vrDiag=0.
+      vtDiag=0.
+      vpDiag=0.
+      vr2Diag=0.
+      vt2Diag=0.
+      vp2Diag=0.
+      vrtDiag=0.
+      vrpDiag=0.
+      vtpDiag=0.
+
+c Mesh
+      nrpre=4*nrsize
+      ntpre=4*nthsize
+      nppre=4*npsisize
+      allocate(r(0:nrsize),rcc(0:nrsize),th(0:nthsize),tcc(0:nthsize)
+     $     ,thang(0:nthsize),pcc(0:npsisize),volinv(0:nrsize))
+      allocate(irpre(nrpre),itpre(ntpre),ippre(nppre))
+      allocate(hr(0:nrsize+1),zeta(0:nrsize+1),zetahalf(0:nrsize+1)
+     $     ,cminus(nrsize),cmid(nrsize),cplus(nrsize))
+      r=0.
+      rcc=0.
+      th=0.
+      tcc=0.
+      thang=0.
+      pcc=0.
+      volinv=0.
+      irpre=0
+      itpre=0
+      ippre=0
+      hr=0.
+      zeta=0.
+      zetahalf=0.
+      cminus=0.
+      cmid=0.
+      cplus=0.
+      allocate(ercache(0:nrsize,nthsize,npsisize)
+     $     ,etcache(nrsize,2:2*nthsize,npsisize)
+     $     ,epcache(nrsize,nthsize,2:2*npsisize+2))
+      ercache=0.
+      etcache=0.
+      epcache=0.
+
+c Diagnostics
+      allocate(diagrho(nrsize),diagphi(nrsize),diagchi(0:nthsize))
+      allocate(fluxprobe(nstepmax),zmom(nstepmax,5,2)
+     $     ,xmom(nstepmax,2:5,2),ymom(nstepmax,2:5,2),enertot(nstepmax))
+      allocate(nincellstep(nthsize,npsisize,0:nstepmax)
+     $     ,vrincellstep(nthsize,npsisize,0:nstepmax)
+     $     ,vr2incellstep(nthsize,npsisize,0:nstepmax))
+      allocate(nincell(nthsize,npsisize),vrincell(nthsize,npsisize)
+     $     ,vr2incell(nthsize,npsisize),fincellave(nthsize,npsisize)
+     $     ,vrincellave(nthsize,npsisize)
+     $     ,vr2incellave(nthsize,npsisize))
+      diagrho=0.
+      diagphi=0.
+      diagchi=0.
+      fluxprobe=0.
+      zmom=0.
+      xmom=0.
+      ymom=0.
+      enertot=0.
+      nincellstep=0.
+      vrincellstep=0.
+      vr2incellstep=0.
+      nincell=0.
+      vrincell=0.
+      vr2incell=0.
+      fincellave=0.
+      vrincellave=0.
+      vr2incellave=0.
+
+c Reduction buffers and psi slabs
+      nsumbuf=13*(nrsize-1)*(nthsize-1)*(npsisize-1)+4
+      nprtbuf=9+3*nthsize*npsisize+3*nvmax
+      allocate(sumbuf(nsumbuf),sumbuftot(nsumbuf),prtbuf(nprtbuf)
+     $     ,prtbuftot(nprtbuf))
+      allocate(isumreq(npsisize),kpsl(0:npsisize),isumoff(0:npsisize)
+     $     ,kslown(npsisize))
+      sumbuf=0.
+      sumbuftot=0.
+      prtbuf=0.
+      prtbuftot=0.
+      isumreq=0
+      kpsl=0
+      isumoff=0
+      kslown=0
+
+c Poisson coefficients
+      allocate(apc(0:nrsize),bpc(0:nrsize),cpc(0:nrsize,0:nthsize)
+     $     ,dpc(0:nrsize,0:nthsize),epc(0:nrsize,0:nthsize)
+     $     ,fpc(0:nrsize,0:nthsize),gpc(0:nthsize,0:npsisize,1:5))
+      allocate(adiag(nrsize*(nthsize+2)*(npsisize+1)))
+      apc=0.
+      bpc=0.
+      cpc=0.
+      dpc=0.
+      epc=0.
+      fpc=0.
+      gpc=0.
+      adiag=0.
+
+c Orbits
+      allocate(xorbit(nstepmax,nobsmax),yorbit(nstepmax,nobsmax)
+     $     ,zorbit(nstepmax,nobsmax),rorbit(nstepmax,nobsmax)
+     $     ,vxorbit(nstepmax,nobsmax),vyorbit(nstepmax,nobsmax)
+     $     ,vzorbit(nstepmax,nobsmax))
+      xorbit=0.
+      yorbit=0.
+      zorbit=0.
+      rorbit=0.
+      vxorbit=0.
+      vyorbit=0.
+      vzorbit=0.
+
+      end
 c***********************************************************************
       subroutine meshinitcic(rmax)
       real rmax
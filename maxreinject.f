@@ -63,7 +63,7 @@ c Pick normal velocity from cumulative G.
 c New angle interpolation.
       ct=1.-2.*(x-1.)/(nQth-1)
 c Map back to th for phihere.
-      call invtfunc(th(1),nth,ct,x)
+      call invtfunc(th(1:nth),nth,ct,x)
       ic1h=x
       ic2h=ic1h+1
       dch=x-ic1h
@@ -0,0 +1,32 @@
+c*********************************************************************
+c Multigrid preconditioner storage, see multigrid.f. Include after
+c piccom.f. The levels are stored one after the other in flat arrays;
+c level l has mgn1(l)*mgn2(l)*mgn3(l) cells starting after mgoff(l).
+c The arrays are allocated at the first mgsetup, mgsize being the
+c total number of cells and mgcsize that of the coarse levels.
+      integer mglmax,mgcmax
+c Most levels, and most cells of the coarsest level, which is solved
+c directly
+      parameter (mglmax=24,mgcmax=64)
+      integer mglev,mgn1(mglmax),mgn2(mglmax),mgn3(mglmax),mgoff(mglmax)
+      integer mgsize,mgcsize
+c 7-point stencil of A on the fine level: centre, +r, -r, +theta,
+c -theta, +psi, -psi
+      real, pointer, contiguous :: mgcc(:),mgce(:),mgcw(:),mgcn(:)
+     $     ,mgcs(:),mgcu(:),mgcd(:)
+c Same for the transpose A' (the centre is shared)
+      real, pointer, contiguous :: mgte(:),mgtw(:),mgtn(:),mgts(:)
+     $     ,mgtu(:),mgtd(:)
+c 27-point stencils of the coarse levels, (-1:1,-1:1,-1:1) per cell,
+c level l>1 starting after 27*(mgoff(l)-mgoff(2)), and of their
+c transposes
+      real, pointer, contiguous :: mga(:),mgat(:)
+c Solution, right hand side and residual on each level
+      real, pointer, contiguous :: mgx(:),mgb(:),mgr(:)
+c LU factors, with row interchanges, of the coarsest level matrix
+      integer mgnc,mgpiv(mgcmax)
+      real mglu(mgcmax,mgcmax)
+      common /mgcom/mgcc,mgce,mgcw,mgcn,mgcs
+     $     ,mgcu,mgcd,mgte,mgtw,mgtn,mgts,mgtu,mgtd,mga,mgat,mgx,mgb
+     $     ,mgr,mglu,mglev,mgn1,mgn2,mgn3,mgoff,mgsize,mgcsize,mgnc
+     $     ,mgpiv
@@ -14,10 +14,15 @@ c iuds used dimensions of u
 c Inside this routine, u and iorig are referenced linearly.
       real u(*)
 c kc      is iteration count which also determines the end of the solver
+c         kc=-1 gathers the blocks to process 0.
+c         kc=-2 starts a non-blocking exchange of the faces, without the
+c         edges and corners, and kc=-3 waits for it to complete. u must
+c         not be used in between except away from the block faces.
       integer kc
 c iorig(idims(1)+1,idims(2)+1,...) (IN) is a pointer to the
 c origin of block(i,j,..) within u.
-c Blocks must be of equal size except for the uppermost
+c In each dimension the blocks may have two sizes, that of the first
+c block and that of the uppermost, as made by bbdydefine.
 c The top of uppermost, with iblock=idims(n)) is indicated
 c by a value pointing to 1 minus the used length of u in that dimension.
       integer iorig(*)
@@ -48,8 +53,7 @@ c to calling process.
 c Subsequently, do the boundary communication.
 c---------------------------------------------------------------
 c Start of local variables.
-      logical lalltoall
-      parameter (idebug=0,lalltoall=.false.)
+      parameter (idebug=0)
 c Local storage:
       logical lreorder
 c vector type ids for each dimension (maximum 10 dimensions)
@@ -58,7 +62,13 @@ c facevector ids for each dimension; bulk, top.
 c These are the handles to datatype that picks out data in the correct
 c pattern, based on the u-address provided to the MPI call.
       integer iface(imds,2)
-c Integer indication of whether we are bulk (1), top (2), or inner (3)
+c Same, but without the ghost cells of the other dimensions, so that
+c the faces of a non-blocking exchange do not overlap
+      integer ifacei(imds)
+c Requests of the non-blocking exchange in progress
+      integer ireq(4*imds),nreq
+c Integer indication of whether our side length is that of the first
+c (1) or the uppermost (2) block
       integer ibt(imds)
 c stack pointers and lengths iall(imds) points to the place in the 
 c stack is where the vector starts. lall is the vector length.
@@ -68,7 +78,7 @@ c shift source and destination ids for each dimension left and right
 c Right and left u-origins of each dimension for this block.
 c      integer iobr(imds),iobl(imds)
 c iside(imds,2) holds the side length of blocks in u for each dimension.
-c iside(*,1) is the general value, iside(*,2) the uppermost value.
+c iside(*,1) is the first block value, iside(*,2) the uppermost value.
       integer iside(imds,2)
 c irdims is the block count per dimension array with the order of the
 c dimensions reversed to maintian fortran compatibility. 
@@ -80,11 +90,7 @@ c Possibly this should be passed to the routine.
       parameter (istacksize=100000)
       integer is(istacksize)
       integer ktype(2**imds)
-c Arrays for constructing ALLtoALL calls.
-      parameter (maxprocs=1000)
-      integer isdispls(maxprocs),irdispls(maxprocs)
-      integer istypes(maxprocs),irtypes(maxprocs)
-      integer iscounts(maxprocs),ircounts(maxprocs)
+c Block type index and coordinates of a block, for the gather
       integer iconp(imds)
 c      character*40 string
 c Debugging arrays
@@ -101,9 +107,24 @@ c instances in one program. No way to reset this. Might include as
 c an argument to allow us to reset. Not done yet.
       logical lflag
 c      data lflag/.false./
+c Whether types and a topology of a previous setup exist
+      logical lbset
+      data lbset/.false./
       save
 
       if(.not.lflag)then
+         if(lbset)then
+c Free those of the previous setup
+            do n=1,ndims
+               call MPI_TYPE_FREE(iface(n,ibt(n)),ierr)
+               call MPI_TYPE_FREE(ifacei(n),ierr)
+            enddo
+            do ith=2,2**(ndims+1)-1
+               call MPI_TYPE_FREE(ktype(ith),ierr)
+            enddo
+            call MPI_COMM_FREE(icommcart,ierr)
+         endif
+         lbset=.true.
 
 c -----------------------------------------------------------------
 c First time. Set up topology and calculate comm-types
@@ -129,11 +150,6 @@ c Count the processes needed for this topology
             nproc=nproc*idims(n)
          enddo
 
-
-         if(nproc.gt.maxprocs) then
-            write(*,*)'Too many processes',nproc,' Increase maxprocs.'
-            goto 999
-         endif
 c         write(*,*)'iLcoords',iLcoords
 c Output some diagnostic data, perhaps.
          if(idebug.gt.0) call bbdyorigprint(ndims,idims,iorig)
@@ -195,16 +211,22 @@ c     icoords(n)=ircoords(n)
          enddo
 
          do n=1,ndims
-            ibt(n)=1
-            if(icoords(n).eq.idims(n)-1) ibt(n)=2
 c     Get my block side lengths, now knowing my cluster position.
-            myside(n)=iside(n,ibt(n))
+            io=1+icoords(n)*iLcoords(n)
+            myside(n)=(iorig(io+iLcoords(n))-iorig(io))/iLs(n)+2
+            ibt(n)=1
+            if(myside(n).ne.iside(n,1)) ibt(n)=2
+            if(myside(n).ne.iside(n,ibt(n)))then
+               write(*,*)'MPI setup error: block side',myside(n),
+     $              ' is neither',iside(n,1),' nor',iside(n,2)
+               goto 999
+            endif
          enddo
 
 c     Determine if the current block is at the inner or/and outer boundary
 c     of the domain
 
-         if (ibt(1).eq.2) then
+         if (icoords(1).eq.idims(1)-1) then
             out=.true.
          else
             out=.false.
@@ -238,7 +260,7 @@ c which however are not used externally.
 
 c nn is the normal direction
             call bbdyfacecreate(nn,ndims,ibeg,is,iLs,myside,
-     $           iall,lall,id)
+     $           iall,lall,id,0)
 
             if(idebug.gt.1)then
             write(*,*)'Face indices, direction nn=',nn,', block-dims'
@@ -263,7 +285,21 @@ c     all at once with lall and iall
             call MPI_TYPE_INDEXED(lall(id),is(iblens),is(iall(id)),
      $           MPI_REAL,iface(nn,ibt(nn)),ierr)
             call MPI_TYPE_COMMIT(iface(nn,ibt(nn)),ierr)
+
+c     Face without the ghost cells of the other dimensions
+            ibeg=1
+            call bbdyfacecreate(nn,ndims,ibeg,is,iLs,myside,
+     $           iall,lall,id,1)
+            iblens=ibeg
+            do i=1,lall(id)
+               is(ibeg)=1
+               ibeg=ibeg+1
+            enddo
+            call MPI_TYPE_INDEXED(lall(id),is(iblens),is(iall(id)),
+     $           MPI_REAL,ifacei(nn),ierr)
+            call MPI_TYPE_COMMIT(ifacei(nn),ierr)
          enddo
+         nreq=0
 
          iobindex=1
          ioffset=0
@@ -283,10 +319,10 @@ c Shifts compensating for the dimension order reversal.
      $           isdl(n),iddl(n),ierr)
          enddo
          myorig=iorig(iobindex)
-c         myorig1=iorig(icoords(1)+1)
-         myorig1=icoords(1)*(iside(1,1)-2)+1
-         myorig2=icoords(2)*(iside(2,1)-2)
-         myorig3=icoords(3)*(iside(3,1)-2)
+c Offsets of my block in each dimension, the first one plus 1.
+         myorig1=(iorig(1+icoords(1)*iLcoords(1))-1)/iLs(1)+1
+         myorig2=(iorig(1+icoords(2)*iLcoords(2))-1)/iLs(2)
+         myorig3=(iorig(1+icoords(3)*iLcoords(3))-1)/iLs(3)
 c--------------------------------------------------------------------
 c Create the types for block gathering.
 c         write(*,*)'calling bbdyblockcreate'
@@ -294,57 +330,9 @@ c         write(*,*)'calling bbdyblockcreate'
          ith0=2**ndims
          if(idebug.ge.1) write(*,*)'Block types:',(ktype(ith),
      $        ith=ith0,2*ith0-1)
-c Create the required arrays for the ALLTOALL
+c My block type, for sending to the gather.
          call bbdycoords(mycartid+1,ndims,idims,iconp,ithi,
-     $        iLcoords,ionp)
-         do np=1,nproc
-c Here we need to send only the active length of data, so the origin
-c is offset.
-            isdispls(np)=(iorig(iobindex)-1+ioffset)*isizeofreal
-            istypes(np)=ktype(ith0+ithi)
-            call bbdycoords(np,ndims,idims,iconp,ithj,
-     $           iLcoords,ionp)
-            irdispls(np)=(iorig(ionp)-1+ioffset)*isizeofreal
-            irtypes(np)=ktype(ith0+ithj)
-
-            if(lalltoall) then
-c All to all
-               if(np.eq.mycartid+1)then
-c Don't send to or receive from myself.
-                  iscounts(np)=0
-                  ircounts(np)=0
-               else
-                  iscounts(np)=1
-                  ircounts(np)=1
-               endif
-            else
-c Gather to process 0 (fortran index 1)
-               if(np.eq.1.and.mycartid+1.ne.np)then
-                  iscounts(np)=1
-               else
-                  iscounts(np)=0
-               endif
-               if(mycartid.eq.0.and.mycartid+1.ne.np)then
-                  ircounts(np)=1
-               else
-                  ircounts(np)=0
-               endif
-            endif
-         enddo
-c Don't send to or receive from anyone test.
-c Process 1 sends to process 0 test
-c         if(mycartid.eq.0) ircounts(2)=1
-c         if(mycartid.eq.1) iscounts(1)=1
-c Process 2 sends to process 0 test
-c         if(mycartid.eq.0) ircounts(3)=1
-c         if(mycartid.eq.2) iscounts(1)=1
-
-
-c         write(*,*)'     np,sendcts,senddp,sendtp,recvcts,recvdp,recvtp'
-c         write(*,'(7i8)')(np,iscounts(np),isdispls(np)/4,
-c     $        mod(istypes(np),10000),
-c     $        ircounts(np),irdispls(np)/4,
-c     $        mod(irtypes(np),10000),np=1,nproc)
+     $        iLcoords,ionp,iorig,iLs,iside)
 c--------------------------------------------------------------------
          if(idebug.ge.2) write(*,*)'End of initialization'
 c         return
@@ -354,6 +342,8 @@ c--------------------------------------------------------------------
 c (First and) Subsequent calls. Do the actual communication
 c--------------------------------------------------------------------
       if(kc.eq.-1)goto 100
+      if(kc.eq.-2)goto 200
+      if(kc.eq.-3)goto 300
 
 
       itag=100
@@ -412,24 +402,60 @@ c shift in the direction left (-1).
 c------------------------------------------------------------------
 c Special cases determined by the value of kc.
  100  continue
-c kc=-1. Do the block exchanging.
-c Debugging test.
-c      do np=1,nproc
-c         istypes(np)=MPI_REAL
-c         irtypes(np)=MPI_REAL
-c      enddo
-      if(idebug.ge.1)then
-         write(*,*)'     np,sendcts,senddp,sendtp,recvcts,recvdp,recvtp'
-         write(*,'(7i8)')(np,iscounts(np),isdispls(np)/4,
-     $        mod(istypes(np),10000),
-     $        ircounts(np),irdispls(np)/4,
-     $        mod(irtypes(np),10000),
-     $        np=1,nproc)
-
+c kc=-1. Do the block gathering to process 0. Only the active
+c region of each block is sent, so the origin is offset.
+      itag=200
+      if(mycartid.eq.0)then
+         do np=2,nproc
+            call bbdycoords(np,ndims,idims,iconp,ithj,
+     $           iLcoords,ionp,iorig,iLs,iside)
+            if(idebug.ge.1)write(*,*)'Gather from',np-1,ionp,ithj
+            call MPI_RECV(u(iorig(ionp)+ioffset),1,ktype(ith0+ithj),
+     $           np-1,itag,icommcart,status,ierr)
+         enddo
+      else
+         call MPI_SEND(u(iorig(iobindex)+ioffset),1,ktype(ith0+ithi),
+     $        0,itag,icommcart,ierr)
       endif
-      call MPI_ALLTOALLW(u,iscounts,isdispls,istypes,
-     $     u,ircounts,irdispls,irtypes,
-     $     icommcart,ierr)
+      return
+
+c kc=-2. Post the face exchange of all the dimensions at once. Each
+c direction has its own tag since both neighbours may be one process.
+ 200  continue
+      itag=100
+      nreq=0
+      iolp=iorig(iobindex)
+      do n=1,ndims
+         iorp=iorig(iobindex+iLcoords(n))
+         iolm=iolp+iLs(n)
+         iorm=iorp+iLs(n)
+         if(isdr(n).ne.-1)then
+            nreq=nreq+1
+            call MPI_IRECV(u(iolp),1,ifacei(n),isdr(n),itag+2*n,
+     $           icommcart,ireq(nreq),ierr)
+         endif
+         if(isdl(n).ne.-1)then
+            nreq=nreq+1
+            call MPI_IRECV(u(iorm),1,ifacei(n),isdl(n),itag+2*n+1,
+     $           icommcart,ireq(nreq),ierr)
+         endif
+         if(iddr(n).ne.-1)then
+            nreq=nreq+1
+            call MPI_ISEND(u(iorp),1,ifacei(n),iddr(n),itag+2*n,
+     $           icommcart,ireq(nreq),ierr)
+         endif
+         if(iddl(n).ne.-1)then
+            nreq=nreq+1
+            call MPI_ISEND(u(iolm),1,ifacei(n),iddl(n),itag+2*n+1,
+     $           icommcart,ireq(nreq),ierr)
+         endif
+      enddo
+      return
+
+c kc=-3. Complete the exchange started with kc=-2.
+ 300  continue
+      if(nreq.gt.0)call MPI_WAITALL(nreq,ireq,MPI_STATUSES_IGNORE,ierr)
+      nreq=0
       return
 
 c Exception stop:
@@ -450,9 +476,11 @@ c with iinc added to it.
       end
 c****************************************************************
       subroutine bbdyfacecreate(nn,nd,ibeg,is,iLs,myside,
-     $     iall,lall,id)
+     $     iall,lall,id,igh)
 c nn: normal dimension, nd: total dimensions.
-      integer nn,nd,id
+c igh: 0 the whole face, 1 the face without the ghost cells of the
+c other dimensions.
+      integer nn,nd,id,igh
 c ibeg: stack counter, is: stack array, iLs: u-structure,
 c myside: block length in dimension n.
       integer ibeg,is(*),iLs(nd+1),myside(nd)
@@ -478,8 +506,8 @@ c     Count of the dimension id starting at two.
          id=nc-nn+2
 
          iall(id)=ibeg
-         iinc=0
-         do i=1,myside(n)
+         iinc=igh*iLs(n)
+         do i=1,myside(n)-2*igh
 c     write(*,*)'iinc=',iinc,iainc
 c     create array is with the face index
             call bbdycatstep(is,ibeg,iall(id-1),lall(id-1),iinc)
@@ -534,17 +562,14 @@ c Define the block origin addresses
       ibeg=2
       ifn=1
       iLs(1)=1
+c The used length is shared as evenly as possible: the first
+c mod(iuds(n)-2,idims(n)) blocks have one more cell than the others.
       do n=1,ndims
-         isz=2+(iuds(n)-2)/idims(n)
-         if(mod(isz,2).eq.1)isz=isz-1
-         istep=(isz-2)*ifn
+         isz=(iuds(n)-2)/idims(n)
+         irem=mod(iuds(n)-2,idims(n))
          ilen=ibeg-1
          do i=1,idims(n)
-            if(i.eq.idims(n))then
-               iinc=(iuds(n)-2)*ifn
-            else
-               iinc=i*istep
-            endif
+            iinc=(i*isz+min(i,irem))*ifn
 c            write(*,*)'iinc,ifn,istep,isz=',iinc,ifn,istep,isz
             call bbdycatstep(iorig,ibeg,1,ilen,iinc)
          enddo
@@ -617,26 +642,34 @@ c We only commit the top level that we are going to use.
 
       end
 c*********************************************************************
-      subroutine bbdycoords(nn,ndims,idims,icoords,ith,iLcoords,ionp)
+      subroutine bbdycoords(nn,ndims,idims,icoords,ith,iLcoords,ionp,
+     $     iorig,iLs,iside)
 c Obtain the cartesian coordinates of nn, in ndims dimensions, idims
 c Return it in icoords. Return the type index (zero-based), i.e.
-c whether we are in bulk on on boundary in ith.
+c whether the side in each dimension is that of the first block or of
+c the uppermost, in ith.
 c Also the iorig index, ionp, for this block.
+      parameter(imds=10)
       integer nn,ndims
       integer icoords(ndims),idims(ndims)
       integer ith
       integer iLcoords(ndims+1)
+      integer iorig(*),iLs(ndims+1),iside(imds,2)
       in=nn-1
       ith=0
       ionp=1
       do nd=1,ndims
          iquot=in/idims(nd)
          icoords(nd)=in-iquot*idims(nd)
-         if(icoords(nd)+1.eq.idims(nd)) ith=ith+2**(nd-1)
 c         write(*,*)'nd,icoords(nd),in,iquot',nd,icoords(nd),in,iquot
          in=iquot
 c Since iorig has dimensions 1+idims this is needed:
          ionp=ionp+icoords(nd)*iLcoords(nd)
       enddo
+      do nd=1,ndims
+         io=1+icoords(nd)*iLcoords(nd)
+         if((iorig(io+iLcoords(nd))-iorig(io))/iLs(nd)+2
+     $        .ne.iside(nd,1)) ith=ith+2**(nd-1)
+      enddo
 c      write(*,*)'nn,ith,ndims,idims',nn,ith,ndims,idims
       end
@@ -0,0 +1,1046 @@
+c******************************************************************
+c Multigrid V-cycle preconditioner for the serial Poisson solver cg3D.
+c
+c Each coarse level keeps every other cell of the one above in the
+c directions coarsened, the first, third, ..., and in r and theta also
+c the last, so that the boundary cells stay on every level. The
+c prolongation P is trilinear: a fine cell on a coarse one takes its
+c value, one between two coarse cells their mean. Restriction is R=P',
+c full weighting, and the coarse matrix is the Galerkin product R A P.
+c That carries the inner Dirichlet condition, the gpc outer condition,
+c the axis and the periodicity in psi down from the fine stencil
+c without special treatment. The coarse stencils have 27 points. The
+c coarsest level, of at most mgcmax cells, is solved by LU
+c decomposition.
+c
+c The mesh is strongly anisotropic: the radial coupling dominates away
+c from the probe, the psi coupling near the axis, increasingly so as
+c the mesh is refined, and the theta coupling at the equator close to
+c the probe. Coarsening in all directions at once then converges
+c worse with each refinement, so the levels are coarsened in r only
+c until two radial cells are left, and only then in theta and psi.
+c The smoother must then remove the error that oscillates in r
+c whatever its theta and psi dependence. It is line Gauss-Seidel:
+c a sweep over the r lines, then the theta lines, then the psi lines,
+c each line solved exactly. After the coarse correction the same
+c steps are taken in the reverse order, so the cycle run on the
+c transposed stencils is exactly the transpose of the preconditioner,
+c which the biconjugate gradient needs for its second sequence.
+c
+c The coarse levels together have about as many cells as the fine one
+c and each stores two 27-point stencils, so the storage is some 54
+c reals per fine cell.
+c******************************************************************
+      subroutine mgsetup(n1,n2,n3,dg)
+
+c Build the level hierarchy for the current matrix of atimes, whose
+c diagonal is dg. Must be called whenever phi has changed.
+
+      include 'piccom.f'
+      include 'mgcom.f'
+      integer n1,n2,n3
+      real dg(n1+1,0:n2+1,0:*)
+
+      mglev=1
+      mgn1(1)=n1-1
+      mgn2(1)=n2
+      mgn3(1)=n3
+      mgoff(1)=0
+c Coarsen at least once, then until the problem is small; in r while
+c that still halves it, then in theta and psi
+ 10   l=mglev
+      m=mgn1(l)*mgn2(l)*mgn3(l)
+      if(mglev.eq.1 .or. m.gt.mgcmax)then
+         if(mglev.eq.mglmax)then
+            write(*,*)'Multigrid levels too few',mglmax
+            stop
+         endif
+         mglev=mglev+1
+         mgn1(l+1)=mgn1(l)/2+1
+         mgn2(l+1)=mgn2(l)
+         mgn3(l+1)=mgn3(l)
+         if(mgn1(l+1).eq.mgn1(l))then
+            mgn2(l+1)=mgn2(l)/2+1
+            mgn3(l+1)=(mgn3(l)+1)/2
+         endif
+         mgoff(l+1)=mgoff(l)+m
+         goto 10
+      endif
+      mgnc=m
+
+      if(.not.associated(mgcc))then
+         mgsize=mgoff(mglev)+m
+         mgcsize=mgsize-mgoff(2)
+         m=mgoff(2)
+         allocate(mgcc(m),mgce(m),mgcw(m),mgcn(m),mgcs(m),mgcu(m)
+     $        ,mgcd(m))
+         allocate(mgte(m),mgtw(m),mgtn(m),mgts(m),mgtu(m),mgtd(m))
+         allocate(mga(27*mgcsize),mgat(27*mgcsize))
+         allocate(mgx(mgsize),mgb(mgsize),mgr(mgsize))
+      endif
+      if(mgoff(mglev)+mgnc.gt.mgsize)then
+         write(*,*)'Multigrid storage too small',mgsize
+         stop
+      endif
+
+      call mgfine(n1,mgn1(1),mgn2(1),mgn3(1),dg,mgcc,mgce,mgcw,mgcn
+     $     ,mgcs,mgcu,mgcd)
+      call mgtrans(mgn1(1),mgn2(1),mgn3(1),mgce,mgcw,mgcn,mgcs,mgcu
+     $     ,mgcd,mgte,mgtw,mgtn,mgts,mgtu,mgtd)
+      call mgrap7(mgn1(1),mgn2(1),mgn3(1),mgcc,mgce,mgcw,mgcn,mgcs
+     $     ,mgcu,mgcd,mgn1(2),mgn2(2),mgn3(2),mga)
+      do l=2,mglev
+         ia=27*(mgoff(l)-mgoff(2))+1
+         if(l.lt.mglev)then
+            ic=27*(mgoff(l+1)-mgoff(2))+1
+            call mgrap27(mgn1(l),mgn2(l),mgn3(l),mga(ia:)
+     $           ,mgn1(l+1),mgn2(l+1),mgn3(l+1),mga(ic:))
+         endif
+         call mgtrans27(mgn1(l),mgn2(l),mgn3(l),mga(ia:),mgat(ia:))
+      enddo
+
+c Factor the coarsest level
+      ia=27*(mgoff(mglev)-mgoff(2))+1
+      call mgdense(mgn1(mglev),mgn2(mglev),mgn3(mglev),mga(ia:)
+     $     ,mgcmax,mglu)
+      call mglufac(mgnc,mgcmax,mglu,mgpiv)
+
+      end
+c******************************************************************
+      subroutine mgfine(n1,m1,m2,m3,dg,ac,ae,aw,an,as,au,ad)
+
+c Fine level stencil, identical to atimes for the unknowns i=2..n1
+c (local index i-1). The ghost value beyond n1 is folded into the
+c stencil of i=n1, and the inner Dirichlet value x(1)=0 drops out.
+
+      include 'piccom.f'
+      integer n1,m1,m2,m3
+      real dg(n1+1,0:m2+1,0:*)
+      real ac(m1,m2,m3),ae(m1,m2,m3),aw(m1,m2,m3),an(m1,m2,m3)
+     $     ,as(m1,m2,m3),au(m1,m2,m3),ad(m1,m2,m3)
+
+      do k=1,m3
+         do j=1,m2
+            do il=1,m1
+               i=il+1
+               ac(il,j,k)=-dg(i,j,k)
+               ae(il,j,k)=apc(i)
+               aw(il,j,k)=bpc(i)
+               an(il,j,k)=cpc(i,j)
+               as(il,j,k)=dpc(i,j)
+               au(il,j,k)=epc(i,j)
+               ad(il,j,k)=epc(i,j)
+            enddo
+            aw(1,j,k)=0.
+            i=n1
+            ae(m1,j,k)=0.
+            aw(m1,j,k)=bpc(i)+apc(i)*gpc(j,k,1)
+            as(m1,j,k)=dpc(i,j)+apc(i)*gpc(j,k,2)
+            an(m1,j,k)=cpc(i,j)+apc(i)*gpc(j,k,3)
+            ac(m1,j,k)=ac(m1,j,k)+apc(i)*gpc(j,k,5)
+         enddo
+         do il=1,m1
+            as(il,1,k)=0.
+            an(il,m2,k)=0.
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgtrans(m1,m2,m3,ae,aw,an,as,au,ad,te,tw,tn,ts,tu,td)
+
+c Off-diagonal stencil of the transpose: the coupling of a cell to its
+c neighbour in A' is the neighbour's coupling back to it in A.
+
+      integer m1,m2,m3
+      real ae(m1,m2,m3),aw(m1,m2,m3),an(m1,m2,m3)
+     $     ,as(m1,m2,m3),au(m1,m2,m3),ad(m1,m2,m3)
+      real te(m1,m2,m3),tw(m1,m2,m3),tn(m1,m2,m3)
+     $     ,ts(m1,m2,m3),tu(m1,m2,m3),td(m1,m2,m3)
+
+      do k=1,m3
+         kp=mod(k,m3)+1
+         km=mod(k+m3-2,m3)+1
+         do j=1,m2
+            do i=1,m1
+               te(i,j,k)=0.
+               tw(i,j,k)=0.
+               tn(i,j,k)=0.
+               ts(i,j,k)=0.
+               if(i.lt.m1)te(i,j,k)=aw(i+1,j,k)
+               if(i.gt.1)tw(i,j,k)=ae(i-1,j,k)
+               if(j.lt.m2)tn(i,j,k)=as(i,j+1,k)
+               if(j.gt.1)ts(i,j,k)=an(i,j-1,k)
+               tu(i,j,k)=ad(i,j,kp)
+               td(i,j,k)=au(i,j,km)
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgpweights(m,mc,lper,ip,wp)
+
+c Interpolation weights in one direction from mc coarse to m fine
+c cells: fine cell i takes wp(1,i) of coarse cell ip(1,i) and wp(2,i)
+c of ip(2,i). Periodic if lper, else the last cells coincide.
+
+      integer m,mc
+      logical lper
+      integer ip(2,m)
+      real wp(2,m)
+
+      do i=1,m
+         if(mc.eq.m)then
+            ip(1,i)=i
+         elseif(mod(i,2).eq.1)then
+            ip(1,i)=(i+1)/2
+         elseif(i.eq.m .and. .not.lper)then
+            ip(1,i)=mc
+         else
+            ip(1,i)=i/2
+            ip(2,i)=mod(i/2,mc)+1
+            wp(1,i)=0.5
+            wp(2,i)=0.5
+            goto 1
+         endif
+         ip(2,i)=ip(1,i)
+         wp(1,i)=1.
+         wp(2,i)=0.
+ 1       continue
+      enddo
+
+      end
+c******************************************************************
+      integer function mgkoff(kc,kf,mc3)
+
+c Stencil offset in psi from coarse cell kc to kf, mc3 being periodic.
+c With two cells both neighbours are the same and stored as +1.
+
+      integer kc,kf,mc3
+
+      mgkoff=mod(kf-kc+mc3,mc3)
+      if(mgkoff.gt.1)mgkoff=mgkoff-mc3
+
+      end
+c******************************************************************
+      subroutine mgrapadd(v,ipf,wpf,jpf,wjf,kpf,wkf,ipg,wpg,jpg,wjg
+     $     ,kpg,wkg,mc1,mc2,mc3,ac)
+
+c Add the contribution P' v P of the fine coupling v from cell f to
+c cell g to the coarse stencil ac. The ip, wp pairs are the weights of
+c mgpweights for f and g in each direction.
+
+      integer ipf(2),jpf(2),kpf(2),ipg(2),jpg(2),kpg(2),mc1,mc2,mc3
+      real v,wpf(2),wjf(2),wkf(2),wpg(2),wjg(2),wkg(2)
+      real ac(-1:1,-1:1,-1:1,mc1,mc2,mc3)
+
+      do kx=1,2
+         if(wkf(kx).ne.0.)then
+         do ky=1,2
+            if(wkg(ky).ne.0.)then
+            kd=mgkoff(kpf(kx),kpg(ky),mc3)
+            do jx=1,2
+               if(wjf(jx).ne.0.)then
+               do jy=1,2
+                  if(wjg(jy).ne.0.)then
+                  jd=jpg(jy)-jpf(jx)
+                  w=v*wkf(kx)*wkg(ky)*wjf(jx)*wjg(jy)
+                  do ix=1,2
+                     if(wpf(ix).ne.0.)then
+                     do iy=1,2
+                        if(wpg(iy).ne.0.)then
+                        id=ipg(iy)-ipf(ix)
+                        ac(id,jd,kd,ipf(ix),jpf(jx),kpf(kx))=
+     $                       ac(id,jd,kd,ipf(ix),jpf(jx),kpf(kx))
+     $                       +w*wpf(ix)*wpg(iy)
+                        endif
+                     enddo
+                     endif
+                  enddo
+                  endif
+               enddo
+               endif
+            enddo
+            endif
+         enddo
+         endif
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgrap7(m1,m2,m3,ac,ae,aw,an,as,au,ad,mc1,mc2,mc3,acc)
+
+c Galerkin coarse stencil acc=P'AP of the fine 7-point stencil.
+
+      integer m1,m2,m3,mc1,mc2,mc3
+      real ac(m1,m2,m3),ae(m1,m2,m3),aw(m1,m2,m3),an(m1,m2,m3)
+     $     ,as(m1,m2,m3),au(m1,m2,m3),ad(m1,m2,m3)
+      real acc(27,mc1,mc2,mc3)
+      integer ip(2,m1),jp(2,m2),kp(2,m3)
+      real wp(2,m1),wj(2,m2),wk(2,m3)
+
+      call mgpweights(m1,mc1,.false.,ip,wp)
+      call mgpweights(m2,mc2,.false.,jp,wj)
+      call mgpweights(m3,mc3,.true.,kp,wk)
+      do kc=1,mc3
+         do jc=1,mc2
+            do ic=1,mc1
+               do id=1,27
+                  acc(id,ic,jc,kc)=0.
+               enddo
+            enddo
+         enddo
+      enddo
+
+      do k=1,m3
+         ku=mod(k,m3)+1
+         kd=mod(k+m3-2,m3)+1
+         do j=1,m2
+            jn=min(j+1,m2)
+            js=max(j-1,1)
+            do i=1,m1
+               ie=min(i+1,m1)
+               iw=max(i-1,1)
+               call mgrapadd(ac(i,j,k),ip(1,i),wp(1,i),jp(1,j),wj(1,j)
+     $              ,kp(1,k),wk(1,k),ip(1,i),wp(1,i),jp(1,j),wj(1,j)
+     $              ,kp(1,k),wk(1,k),mc1,mc2,mc3,acc)
+               if(ae(i,j,k).ne.0.)call mgrapadd(ae(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,ie)
+     $              ,wp(1,ie),jp(1,j),wj(1,j),kp(1,k),wk(1,k),mc1,mc2
+     $              ,mc3,acc)
+               if(aw(i,j,k).ne.0.)call mgrapadd(aw(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,iw)
+     $              ,wp(1,iw),jp(1,j),wj(1,j),kp(1,k),wk(1,k),mc1,mc2
+     $              ,mc3,acc)
+               if(an(i,j,k).ne.0.)call mgrapadd(an(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,i)
+     $              ,wp(1,i),jp(1,jn),wj(1,jn),kp(1,k),wk(1,k),mc1,mc2
+     $              ,mc3,acc)
+               if(as(i,j,k).ne.0.)call mgrapadd(as(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,i)
+     $              ,wp(1,i),jp(1,js),wj(1,js),kp(1,k),wk(1,k),mc1,mc2
+     $              ,mc3,acc)
+               if(au(i,j,k).ne.0.)call mgrapadd(au(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,ku),wk(1,ku),mc1,mc2
+     $              ,mc3,acc)
+               if(ad(i,j,k).ne.0.)call mgrapadd(ad(i,j,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,k),wk(1,k),ip(1,i)
+     $              ,wp(1,i),jp(1,j),wj(1,j),kp(1,kd),wk(1,kd),mc1,mc2
+     $              ,mc3,acc)
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgrap27(m1,m2,m3,a,mc1,mc2,mc3,acc)
+
+c Galerkin coarse stencil acc=P'AP of the 27-point stencil a.
+
+      integer m1,m2,m3,mc1,mc2,mc3
+      real a(-1:1,-1:1,-1:1,m1,m2,m3)
+      real acc(27,mc1,mc2,mc3)
+      integer ip(2,m1),jp(2,m2),kp(2,m3)
+      real wp(2,m1),wj(2,m2),wk(2,m3)
+
+      call mgpweights(m1,mc1,.false.,ip,wp)
+      call mgpweights(m2,mc2,.false.,jp,wj)
+      call mgpweights(m3,mc3,.true.,kp,wk)
+      do kc=1,mc3
+         do jc=1,mc2
+            do ic=1,mc1
+               do id=1,27
+                  acc(id,ic,jc,kc)=0.
+               enddo
+            enddo
+         enddo
+      enddo
+
+      do k=1,m3
+         do j=1,m2
+            do i=1,m1
+               do kd=-1,1
+                  kk=mod(k+kd+m3-1,m3)+1
+                  do jd=-1,1
+                     jj=min(max(j+jd,1),m2)
+                     do id=-1,1
+                        ii=min(max(i+id,1),m1)
+                        if(a(id,jd,kd,i,j,k).ne.0.)call mgrapadd(
+     $                       a(id,jd,kd,i,j,k),ip(1,i),wp(1,i),jp(1,j)
+     $                       ,wj(1,j),kp(1,k),wk(1,k),ip(1,ii),wp(1,ii)
+     $                       ,jp(1,jj),wj(1,jj),kp(1,kk),wk(1,kk),mc1
+     $                       ,mc2,mc3,acc)
+                     enddo
+                  enddo
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgtrans27(m1,m2,m3,a,t)
+
+c Transpose of a 27-point stencil, periodic in the third index.
+
+      integer m1,m2,m3
+      real a(-1:1,-1:1,-1:1,m1,m2,m3),t(-1:1,-1:1,-1:1,m1,m2,m3)
+
+      do k=1,m3
+         do j=1,m2
+            do i=1,m1
+               do kd=-1,1
+                  kk=mod(k+kd+m3-1,m3)+1
+c Offsets that the storage folds into another are left zero
+                  kb=mgkoff(kk,k,m3)
+                  do jd=-1,1
+                     do id=-1,1
+                        t(id,jd,kd,i,j,k)=0.
+                        if(mgkoff(k,kk,m3).eq.kd .and.
+     $                       i+id.ge.1 .and. i+id.le.m1 .and.
+     $                       j+jd.ge.1 .and. j+jd.le.m2)
+     $                       t(id,jd,kd,i,j,k)=a(-id,-jd,kb,i+id,j+jd
+     $                       ,kk)
+                     enddo
+                  enddo
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgdense(m1,m2,m3,a,ld,d)
+
+c Dense matrix of the 27-point stencil a.
+
+      integer m1,m2,m3,ld
+      real a(-1:1,-1:1,-1:1,m1,m2,m3),d(ld,*)
+
+      m=m1*m2*m3
+      do iq=1,m
+         do ic=1,m
+            d(ic,iq)=0.
+         enddo
+      enddo
+      do k=1,m3
+         do j=1,m2
+            do i=1,m1
+               iq=i+m1*(j-1+m2*(k-1))
+               do kd=-1,1
+                  kk=mod(k+kd+m3-1,m3)+1
+                  do jd=-1,1
+                     jj=min(max(j+jd,1),m2)
+                     do id=-1,1
+                        ii=min(max(i+id,1),m1)
+                        ic=ii+m1*(jj-1+m2*(kk-1))
+                        d(iq,ic)=d(iq,ic)+a(id,jd,kd,i,j,k)
+                     enddo
+                  enddo
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mglufac(n,ld,d,ipiv)
+
+c In place LU factorization of the n x n matrix d, with partial
+c pivoting: row k was interchanged with row ipiv(k) at step k.
+
+      integer n,ld,ipiv(n)
+      real d(ld,n)
+
+      do k=1,n
+         ipiv(k)=k
+         do ir=k+1,n
+            if(abs(d(ir,k)).gt.abs(d(ipiv(k),k)))ipiv(k)=ir
+         enddo
+         if(ipiv(k).ne.k)then
+            do ic=1,n
+               t=d(k,ic)
+               d(k,ic)=d(ipiv(k),ic)
+               d(ipiv(k),ic)=t
+            enddo
+         endif
+         do ir=k+1,n
+            d(ir,k)=d(ir,k)/d(k,k)
+         enddo
+         do ic=k+1,n
+            do ir=k+1,n
+               d(ir,ic)=d(ir,ic)-d(ir,k)*d(k,ic)
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mglusolve(n,ld,d,ipiv,x,ltrnsp)
+
+c Solve D x=b, or D'x=b if ltrnsp, in place with the factors of
+c mglufac.
+
+      integer n,ld,ipiv(n)
+      real d(ld,n),x(n)
+      logical ltrnsp
+
+      if(ltrnsp)then
+c U'w=b, L'v=w, then undo the interchanges
+         do ic=1,n
+            do ir=1,ic-1
+               x(ic)=x(ic)-d(ir,ic)*x(ir)
+            enddo
+            x(ic)=x(ic)/d(ic,ic)
+         enddo
+         do ic=n,1,-1
+            do ir=ic+1,n
+               x(ic)=x(ic)-d(ir,ic)*x(ir)
+            enddo
+         enddo
+         do k=n,1,-1
+            t=x(k)
+            x(k)=x(ipiv(k))
+            x(ipiv(k))=t
+         enddo
+      else
+         do k=1,n
+            t=x(k)
+            x(k)=x(ipiv(k))
+            x(ipiv(k))=t
+         enddo
+c Ly=Pb then Ux=y
+         do ic=1,n
+            do ir=ic+1,n
+               x(ir)=x(ir)-d(ir,ic)*x(ic)
+            enddo
+         enddo
+         do ic=n,1,-1
+            x(ic)=x(ic)/d(ic,ic)
+            do ir=1,ic-1
+               x(ir)=x(ir)-d(ir,ic)*x(ic)
+            enddo
+         enddo
+      endif
+
+      end
+c******************************************************************
+      subroutine mgsolve(n1,n2,n3,l1,l2,b,z,ltrnsp)
+
+c Apply one V-cycle, z=M^-1 b, or its transpose if ltrnsp. mgsetup
+c must have been called for the current matrix.
+
+      include 'piccom.f'
+      include 'mgcom.f'
+      integer n1,n2,n3,l1,l2
+      real b(l1,0:l2,0:*), z(l1,0:l2,0:*)
+      logical ltrnsp
+
+      do k=1,n3
+         do j=1,n2
+            do i=2,n1
+               mgb(i-1+(n1-1)*(j-1+n2*(k-1)))=b(i,j,k)
+            enddo
+         enddo
+      enddo
+      call mgcycle(ltrnsp)
+      do k=1,n3
+         do j=1,n2
+            do i=2,n1
+               z(i,j,k)=mgx(i-1+(n1-1)*(j-1+n2*(k-1)))
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgcycle(ltrnsp)
+
+c V-cycle from the right hand side in the fine level of mgb to the
+c solution in that of mgx.
+
+      include 'piccom.f'
+      include 'mgcom.f'
+      logical ltrnsp
+c Smoothing sweeps before and after the coarse correction
+      integer nusmooth
+      parameter (nusmooth=1)
+
+c Down: smooth, then restrict the residual as the next right hand side
+      do l=1,mglev-1
+         io=mgoff(l)+1
+         ic=mgoff(l+1)+1
+         m=mgn1(l)*mgn2(l)*mgn3(l)
+         do ii=io,io+m-1
+            mgx(ii)=0.
+         enddo
+         call mgsmooth(l,nusmooth,.false.,ltrnsp)
+         call mgrestrict(mgn1(l),mgn2(l),mgn3(l),mgr(io:)
+     $        ,mgn1(l+1),mgn2(l+1),mgn3(l+1),mgb(ic:))
+      enddo
+
+c Coarsest level
+      io=mgoff(mglev)+1
+      do ii=0,mgnc-1
+         mgx(io+ii)=mgb(io+ii)
+      enddo
+      call mglusolve(mgnc,mgcmax,mglu,mgpiv,mgx(io:),ltrnsp)
+
+c Up: add the coarse correction, then smooth
+      do l=mglev-1,1,-1
+         io=mgoff(l)+1
+         ic=mgoff(l+1)+1
+         call mgprolong(mgn1(l),mgn2(l),mgn3(l),mgx(io:)
+     $        ,mgn1(l+1),mgn2(l+1),mgn3(l+1),mgx(ic:))
+         call mgsmooth(l,nusmooth,.true.,ltrnsp)
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgsmooth(l,nu,lback,ltrnsp)
+
+c nu smoothing sweeps on level l, with A' if ltrnsp. Each is an r line
+c pass, a theta line pass and a psi line pass, or if lback the same
+c in the reverse order, each pass going backward. Leaves the residual
+c in mgr when going forward.
+
+      include 'piccom.f'
+      include 'mgcom.f'
+      integer l,nu
+      logical lback,ltrnsp,lsemi
+
+      io=mgoff(l)+1
+      ia=27*(mgoff(l)-mgoff(2))+1
+      lsemi=mgn2(l).eq.mgn2(1) .and. mgn3(l).eq.mgn3(1)
+      if(l.eq.1)then
+         if(ltrnsp)then
+            call mgline7(mgn1(l),mgn2(l),mgn3(l),mgcc,mgte,mgtw,mgtn
+     $           ,mgts,mgtu,mgtd,mgx,mgb,mgr,nu,lback)
+         else
+            call mgline7(mgn1(l),mgn2(l),mgn3(l),mgcc,mgce,mgcw,mgcn
+     $           ,mgcs,mgcu,mgcd,mgx,mgb,mgr,nu,lback)
+         endif
+      else
+         if(ltrnsp)then
+            call mgline27(mgn1(l),mgn2(l),mgn3(l),mgat(ia:),mgx(io:)
+     $           ,mgb(io:),mgr(io:),nu,lback,lsemi)
+         else
+            call mgline27(mgn1(l),mgn2(l),mgn3(l),mga(ia:),mgx(io:)
+     $           ,mgb(io:),mgr(io:),nu,lback,lsemi)
+         endif
+      endif
+
+      end
+c******************************************************************
+      subroutine mgline7(m1,m2,m3,ac,ae,aw,an,as,au,ad,x,b,r,nu,lback)
+
+c Line Gauss-Seidel sweeps, as mgsmooth, for a 7-point stencil
+c periodic in the third index. The couplings out of the domain in the
+c first two indices are zero. Unless lback, finish with the residual
+c r=b-Ax.
+
+      integer m1,m2,m3,nu
+      real ac(m1,m2,m3),ae(m1,m2,m3),aw(m1,m2,m3),an(m1,m2,m3)
+     $     ,as(m1,m2,m3),au(m1,m2,m3),ad(m1,m2,m3)
+      real x(m1,m2,m3),b(m1,m2,m3),r(m1,m2,m3)
+      logical lback
+      real y(max(m1,m2,m3)),g(max(m1,m2,m3)),h(m3)
+      real u(max(m2,m3)),v(max(m2,m3)),w(max(m2,m3))
+
+      do n=1,nu
+         do jpass=1,3
+            ipass=jpass
+            if(lback)ipass=4-jpass
+            if(ipass.eq.1)then
+c r lines
+               do kk=1,m3
+                  k=kk
+                  if(lback)k=m3+1-kk
+                  kp=mod(k,m3)+1
+                  km=mod(k+m3-2,m3)+1
+                  do jj=1,m2
+                     j=jj
+                     if(lback)j=m2+1-jj
+                     jp=min(j+1,m2)
+                     jm=max(j-1,1)
+                     do i=1,m1
+                        y(i)=b(i,j,k)
+     $                       -an(i,j,k)*x(i,jp,k)-as(i,j,k)*x(i,jm,k)
+     $                       -au(i,j,k)*x(i,j,kp)-ad(i,j,k)*x(i,j,km)
+                     enddo
+                     call mgtri(m1,aw(1,j,k),ac(1,j,k),ae(1,j,k),y,g)
+                     do i=1,m1
+                        x(i,j,k)=y(i)
+                     enddo
+                  enddo
+               enddo
+            elseif(ipass.eq.2)then
+c theta lines
+               do kk=1,m3
+                  k=kk
+                  if(lback)k=m3+1-kk
+                  kp=mod(k,m3)+1
+                  km=mod(k+m3-2,m3)+1
+                  do ii=1,m1
+                     i=ii
+                     if(lback)i=m1+1-ii
+                     ip=min(i+1,m1)
+                     im=max(i-1,1)
+                     do j=1,m2
+                        y(j)=b(i,j,k)
+     $                       -ae(i,j,k)*x(ip,j,k)-aw(i,j,k)*x(im,j,k)
+     $                       -au(i,j,k)*x(i,j,kp)-ad(i,j,k)*x(i,j,km)
+                        u(j)=as(i,j,k)
+                        v(j)=ac(i,j,k)
+                        w(j)=an(i,j,k)
+                     enddo
+                     call mgtri(m2,u,v,w,y,g)
+                     do j=1,m2
+                        x(i,j,k)=y(j)
+                     enddo
+                  enddo
+               enddo
+            else
+c psi lines
+               do jj=1,m2
+                  j=jj
+                  if(lback)j=m2+1-jj
+                  jp=min(j+1,m2)
+                  jm=max(j-1,1)
+                  do ii=1,m1
+                     i=ii
+                     if(lback)i=m1+1-ii
+                     ip=min(i+1,m1)
+                     im=max(i-1,1)
+                     do k=1,m3
+                        y(k)=b(i,j,k)
+     $                       -ae(i,j,k)*x(ip,j,k)-aw(i,j,k)*x(im,j,k)
+     $                       -an(i,j,k)*x(i,jp,k)-as(i,j,k)*x(i,jm,k)
+                        u(k)=ad(i,j,k)
+                        v(k)=ac(i,j,k)
+                        w(k)=au(i,j,k)
+                     enddo
+                     call mgcyc(m3,u,v,w,y,g,h)
+                     do k=1,m3
+                        x(i,j,k)=y(k)
+                     enddo
+                  enddo
+               enddo
+            endif
+         enddo
+      enddo
+      if(lback)return
+
+      do k=1,m3
+         kp=mod(k,m3)+1
+         km=mod(k+m3-2,m3)+1
+         do j=1,m2
+            jp=min(j+1,m2)
+            jm=max(j-1,1)
+            do i=1,m1
+               ip=min(i+1,m1)
+               im=max(i-1,1)
+               r(i,j,k)=b(i,j,k)-ac(i,j,k)*x(i,j,k)
+     $              -ae(i,j,k)*x(ip,j,k)-aw(i,j,k)*x(im,j,k)
+     $              -an(i,j,k)*x(i,jp,k)-as(i,j,k)*x(i,jm,k)
+     $              -au(i,j,k)*x(i,j,kp)-ad(i,j,k)*x(i,j,km)
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgline27(m1,m2,m3,a,x,b,r,nu,lback,lsemi)
+
+c Line Gauss-Seidel sweeps for a 27-point stencil, as mgline7. If
+c lsemi, the level has only been coarsened in r and the couplings
+c across both theta and psi, which then vanish, are skipped.
+
+      integer m1,m2,m3,nu
+      real a(-1:1,-1:1,-1:1,m1,m2,m3)
+      real x(m1,m2,m3),b(m1,m2,m3),r(m1,m2,m3)
+      logical lback,lsemi
+      real y(max(m1,m2,m3)),g(max(m1,m2,m3)),h(m3)
+      real u(max(m1,m2,m3)),v(max(m1,m2,m3)),w(max(m1,m2,m3))
+
+      do n=1,nu
+         do jpass=1,3
+            ipass=jpass
+            if(lback)ipass=4-jpass
+            if(ipass.eq.1)then
+c r lines
+               do kk=1,m3
+                  k=kk
+                  if(lback)k=m3+1-kk
+                  do jj=1,m2
+                     j=jj
+                     if(lback)j=m2+1-jj
+                     call mgrline27(m1,m2,m3,a,x,b,j,k,.false.,lsemi,y)
+                     do i=1,m1
+                        u(i)=a(-1,0,0,i,j,k)
+                        v(i)=a(0,0,0,i,j,k)
+                        w(i)=a(1,0,0,i,j,k)
+                     enddo
+                     call mgtri(m1,u,v,w,y,g)
+                     do i=1,m1
+                        x(i,j,k)=y(i)
+                     enddo
+                  enddo
+               enddo
+            elseif(ipass.eq.2)then
+c theta lines
+               do kk=1,m3
+                  k=kk
+                  if(lback)k=m3+1-kk
+                  do ii=1,m1
+                     i=ii
+                     if(lback)i=m1+1-ii
+                     do j=1,m2
+                        y(j)=b(i,j,k)
+                        u(j)=a(0,-1,0,i,j,k)
+                        v(j)=a(0,0,0,i,j,k)
+                        w(j)=a(0,1,0,i,j,k)
+                     enddo
+                     do kd=-1,1
+                        ks=mod(k+kd+m3-1,m3)+1
+                        do id=-1,1
+                           is=i+id
+                           if(is.ge.1 .and. is.le.m1 .and.
+     $                          (id.ne.0 .or. kd.ne.0))then
+                           do jd=-1,1
+                              if(kd.eq.0 .or. jd.eq.0 .or.
+     $                             .not.lsemi)then
+                              do j=max(1,1-jd),min(m2,m2-jd)
+                                 y(j)=y(j)
+     $                                -a(id,jd,kd,i,j,k)*x(is,j+jd,ks)
+                              enddo
+                              endif
+                           enddo
+                           endif
+                        enddo
+                     enddo
+                     call mgtri(m2,u,v,w,y,g)
+                     do j=1,m2
+                        x(i,j,k)=y(j)
+                     enddo
+                  enddo
+               enddo
+            else
+c psi lines: the right hand side leaves out the couplings along psi
+               do jj=1,m2
+                  j=jj
+                  if(lback)j=m2+1-jj
+                  do ii=1,m1
+                     i=ii
+                     if(lback)i=m1+1-ii
+                     do k=1,m3
+                        y(k)=b(i,j,k)
+                        u(k)=a(0,0,-1,i,j,k)
+                        v(k)=a(0,0,0,i,j,k)
+                        w(k)=a(0,0,1,i,j,k)
+                     enddo
+                     do jd=-1,1
+                        js=j+jd
+                        if(js.ge.1 .and. js.le.m2)then
+                        do id=-1,1
+                           is=i+id
+                           if(is.ge.1 .and. is.le.m1 .and.
+     $                          (id.ne.0 .or. jd.ne.0))then
+                           do kd=-1,1
+                              if(kd.eq.0 .or. jd.eq.0 .or.
+     $                             .not.lsemi)then
+                              do k=1,m3
+                                 ks=k+kd
+                                 if(ks.lt.1)ks=m3
+                                 if(ks.gt.m3)ks=1
+                                 y(k)=y(k)-a(id,jd,kd,i,j,k)*x(is,js,ks)
+                              enddo
+                              endif
+                           enddo
+                           endif
+                        enddo
+                        endif
+                     enddo
+                     call mgcyc(m3,u,v,w,y,g,h)
+                     do k=1,m3
+                        x(i,j,k)=y(k)
+                     enddo
+                  enddo
+               enddo
+            endif
+         enddo
+      enddo
+      if(lback)return
+
+      do k=1,m3
+         do j=1,m2
+            call mgrline27(m1,m2,m3,a,x,b,j,k,.true.,lsemi,r(1,j,k))
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgrline27(m1,m2,m3,a,x,b,j,k,lall,lsemi,y)
+
+c y=b-Ax along the r line (j,k) of the 27-point stencil a, leaving out
+c the couplings along the line unless lall. lsemi as for mgline27.
+
+      integer m1,m2,m3,j,k
+      real a(-1:1,-1:1,-1:1,m1,m2,m3)
+      real x(m1,m2,m3),b(m1,m2,m3),y(m1)
+      logical lall,lsemi
+
+      do i=1,m1
+         y(i)=b(i,j,k)
+      enddo
+      do kd=-1,1
+         ks=mod(k+kd+m3-1,m3)+1
+         do jd=-1,1
+            js=j+jd
+            if(js.ge.1 .and. js.le.m2 .and. (lall .or. jd.ne.0 .or.
+     $           kd.ne.0) .and. (jd.eq.0 .or. kd.eq.0 .or.
+     $           .not.lsemi))then
+               do i=1,m1
+                  y(i)=y(i)-a(0,jd,kd,i,j,k)*x(i,js,ks)
+               enddo
+               do i=2,m1
+                  y(i)=y(i)-a(-1,jd,kd,i,j,k)*x(i-1,js,ks)
+               enddo
+               do i=1,m1-1
+                  y(i)=y(i)-a(1,jd,kd,i,j,k)*x(i+1,js,ks)
+               enddo
+            endif
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgtri(n,aw,ac,ae,y,g)
+
+c Solve the tridiagonal system aw(i)x(i-1)+ac(i)x(i)+ae(i)x(i+1)=y(i)
+c in place, without pivoting. g is work space.
+
+      integer n
+      real aw(n),ac(n),ae(n),y(n),g(n)
+
+      rbet=1./ac(1)
+      y(1)=y(1)*rbet
+      do i=2,n
+         g(i)=ae(i-1)*rbet
+         rbet=1./(ac(i)-aw(i)*g(i))
+         y(i)=(y(i)-aw(i)*y(i-1))*rbet
+      enddo
+      do i=n-1,1,-1
+         y(i)=y(i)-g(i+1)*y(i+1)
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgcyc(n,aw,ac,ae,y,g,h)
+
+c As mgtri for the periodic system, in which aw(1) couples to x(n)
+c and ae(n) to x(1). For n>2 the corners are taken out by the
+c Sherman-Morrison formula. ac is changed; g and h are work space.
+
+      integer n
+      real aw(n),ac(n),ae(n),y(n),g(n),h(n)
+
+      if(n.eq.1)then
+         y(1)=y(1)/(aw(1)+ac(1)+ae(1))
+      elseif(n.eq.2)then
+         c12=aw(1)+ae(1)
+         c21=aw(2)+ae(2)
+         det=ac(1)*ac(2)-c12*c21
+         y1=y(1)
+         y(1)=(ac(2)*y1-c12*y(2))/det
+         y(2)=(ac(1)*y(2)-c21*y1)/det
+      else
+         gam=-ac(1)
+         alp=ae(n)
+         bet=aw(1)
+         ac(1)=ac(1)-gam
+         ac(n)=ac(n)-alp*bet/gam
+         call mgtri(n,aw,ac,ae,y,g)
+         h(1)=gam
+         do i=2,n-1
+            h(i)=0.
+         enddo
+         h(n)=alp
+         call mgtri(n,aw,ac,ae,h,g)
+         fact=(y(1)+bet*y(n)/gam)/(1.+h(1)+bet*h(n)/gam)
+         do i=1,n
+            y(i)=y(i)-fact*h(i)
+         enddo
+      endif
+
+      end
+c******************************************************************
+      subroutine mgrestrict(m1,m2,m3,r,mc1,mc2,mc3,bc)
+
+c Full weighting of the residual, bc=P'r.
+
+      integer m1,m2,m3,mc1,mc2,mc3
+      real r(m1,m2,m3),bc(mc1,mc2,mc3)
+      integer ip(2,m1),jp(2,m2),kp(2,m3)
+      real wp(2,m1),wj(2,m2),wk(2,m3)
+
+      call mgpweights(m1,mc1,.false.,ip,wp)
+      call mgpweights(m2,mc2,.false.,jp,wj)
+      call mgpweights(m3,mc3,.true.,kp,wk)
+      do kc=1,mc3
+         do jc=1,mc2
+            do ic=1,mc1
+               bc(ic,jc,kc)=0.
+            enddo
+         enddo
+      enddo
+      do k=1,m3
+         do kf=1,2
+            do j=1,m2
+               do jf=1,2
+                  w=wk(kf,k)*wj(jf,j)
+                  do i=1,m1
+                     bc(ip(1,i),jp(jf,j),kp(kf,k))=
+     $                    bc(ip(1,i),jp(jf,j),kp(kf,k))
+     $                    +w*wp(1,i)*r(i,j,k)
+                     bc(ip(2,i),jp(jf,j),kp(kf,k))=
+     $                    bc(ip(2,i),jp(jf,j),kp(kf,k))
+     $                    +w*wp(2,i)*r(i,j,k)
+                  enddo
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine mgprolong(m1,m2,m3,x,mc1,mc2,mc3,xc)
+
+c Add the interpolated coarse correction, x=x+P xc.
+
+      integer m1,m2,m3,mc1,mc2,mc3
+      real x(m1,m2,m3),xc(mc1,mc2,mc3)
+      integer ip(2,m1),jp(2,m2),kp(2,m3)
+      real wp(2,m1),wj(2,m2),wk(2,m3)
+
+      call mgpweights(m1,mc1,.false.,ip,wp)
+      call mgpweights(m2,mc2,.false.,jp,wj)
+      call mgpweights(m3,mc3,.true.,kp,wk)
+      do k=1,m3
+         do kf=1,2
+            do j=1,m2
+               do jf=1,2
+                  w=wk(kf,k)*wj(jf,j)
+                  do i=1,m1
+                     x(i,j,k)=x(i,j,k)
+     $                    +w*(wp(1,i)*xc(ip(1,i),jp(jf,j),kp(kf,k))
+     $                    +wp(2,i)*xc(ip(2,i),jp(jf,j),kp(kf,k)))
+                  enddo
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
@@ -1,5 +1,12 @@
 c*********************************************************************
 c Writes the hdf output file
+c Each desired common block is an hdf group. Its scalar parameters are
+c attributes of the group (logicals as 0 or 1), and its arrays are
+c datasets cut to the extents actually used: the mesh to nrused,
+c nthused, npsiused, the step histories to maxsteps and the particles
+c to iocprev. Arrays of the same shape are batched into one dataset
+c along an extra last dimension, whose order is given by its attribute
+c 'names'. Larger datasets are chunked and compressed (see hdfdset).
       subroutine outputhdf(dt,k,fave,icolntype,colnwt)
 c Load the hdf5 module
       use hdf5
@@ -15,24 +22,19 @@ c Common data
 c Functions
       integer nbcat
 c Local variables
-c     File, group, and dataset names
+c     File name
       CHARACTER(LEN=55) :: filename
-      CHARACTER(LEN=55) :: groupname
-      CHARACTER(LEN=55) :: dsetname
 c     File and group ids
       INTEGER(HID_T) :: file_id
       INTEGER(HID_T) :: group_id
 c     Error flag
       INTEGER :: error
-c     Dimensions of dataset (limit rank to <=10)
-      INTEGER(HSIZE_T), DIMENSION(10) :: data_dims, storage_dims
-c     Rank of dataset
-      INTEGER :: rank
+c     Dimensions of a dataset
+      integer idims(6)
+c     Work arrays in which arrays of the same shape are batched
+      real, allocatable :: w1(:,:),w2(:,:,:),w3(:,:,:,:)
 c     Working variables
-      INTEGER :: i, j
-      integer idf
-      REAL, DIMENSION(3,3) :: dset_data1
-      INTEGER, DIMENSION(3,3) :: dset_data2
+      integer idf,n1,n2,n3,ns,nm
 
 c Construct a filename that contains many parameters
 c   using the routines in strings_names.f
@@ -76,14 +78,10 @@ c     Turn on these when testing convergence with changing grid size
 
       idf=nbcat(filename,'.h5')
 
-
-
-      do i = 1, 3
-           do j = 1, 3
-                dset_data1(i,j) = j*1.1;
-                dset_data2(i,j) = j;
-           end do
-      end do
+c Used sizes of the node arrays
+      n1=NRUSED+1
+      n2=NTHUSED+1
+      n3=NPSIUSED+1
 
 c Initialize FORTRAN interface.
       CALL h5open_f(error)
@@ -91,1374 +89,606 @@ c Initialize FORTRAN interface.
 c Create a new file using default properties.
       CALL h5fcreate_f(filename, H5F_ACC_TRUNC_F, file_id, error)
 
-c Now output each desired common block as an hdf group, using the two
-c   custom made functions writehdfintmat() and writehfdrealmat() to
-c   output integer and real (respectively) variables and arrays.
-c   The logical type is treated as integer for output.
-c   For now all variables in each desired common block are output, but it may
-c   be desireable to create a more limited output file to minimize size.
-c   Note that size of each array must be specified throught the rank,
-c   dimensions of the used array (data_dims), and dimensions of the
-c   full arary in memory (storage_dims).
-
-
-
-c Create a group in the file.
-      groupname = 'piccom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'npart'
-      call writehdfintmat(group_id,dsetname,
-     $ npart,storage_dims,data_dims,rank)
-
-      dsetname = 'nr'
-      call writehdfintmat(group_id,dsetname,
-     $ nr,storage_dims,data_dims,rank)
-
-      dsetname = 'nth'
-      call writehdfintmat(group_id,dsetname,
-     $ nth,storage_dims,data_dims,rank)
-
-      dsetname = 'npsi'
-      call writehdfintmat(group_id,dsetname,
-     $ npsi,storage_dims,data_dims,rank)
-
-      dsetname = 'lsubcycle'
-      call writehdfintmat(group_id,dsetname,
-     $ lsubcycle,storage_dims,data_dims,rank)
-
-      dsetname = 'verlet'
-      call writehdfintmat(group_id,dsetname,
-     $ verlet,storage_dims,data_dims,rank)
-
-      dsetname = 'LCIC'
-      call writehdfintmat(group_id,dsetname,
-     $ LCIC,storage_dims,data_dims,rank)
-
-      dsetname = 'collcic'
-      call writehdfintmat(group_id,dsetname,
-     $ collcic,storage_dims,data_dims,rank)
-
-      dsetname = 'NRUSED'
-      call writehdfintmat(group_id,dsetname,
-     $ NRUSED,storage_dims,data_dims,rank)
-
-      dsetname = 'NTHUSED'
-      call writehdfintmat(group_id,dsetname,
-     $ NTHUSED,storage_dims,data_dims,rank)
-
-      dsetname = 'NPSIUSED'
-      call writehdfintmat(group_id,dsetname,
-     $ NPSIUSED,storage_dims,data_dims,rank)
-
-      dsetname = 'NRFULL'
-      call writehdfintmat(group_id,dsetname,
-     $ NRFULL,storage_dims,data_dims,rank)
-
-      dsetname = 'NTHFULL'
-      call writehdfintmat(group_id,dsetname,
-     $ NTHFULL,storage_dims,data_dims,rank)
-
-      dsetname = 'NPSIFULL'
-      call writehdfintmat(group_id,dsetname,
-     $ NPSIFULL,storage_dims,data_dims,rank)
-
-      dsetname = 'ninjcomp'
-      call writehdfintmat(group_id,dsetname,
-     $ ninjcomp,storage_dims,data_dims,rank)
-
-      dsetname = 'iocprev'
-      call writehdfintmat(group_id,dsetname,
-     $ iocprev,storage_dims,data_dims,rank)
-
-      dsetname = 'cerr'
-      call writehdfrealmat(group_id,dsetname,
-     $ cerr,storage_dims,data_dims,rank)
-
-      dsetname = 'bdyfc'
-      call writehdfrealmat(group_id,dsetname,
-     $ bdyfc,storage_dims,data_dims,rank)
-
-      dsetname = 'Ti'
-      call writehdfrealmat(group_id,dsetname,
-     $ Ti,storage_dims,data_dims,rank)
-
-      dsetname = 'vd'
-      call writehdfrealmat(group_id,dsetname,
-     $ vd,storage_dims,data_dims,rank)
-
-      dsetname = 'cd'
-      call writehdfrealmat(group_id,dsetname,
-     $ cd,storage_dims,data_dims,rank)
-
-      dsetname = 'cB'
-      call writehdfrealmat(group_id,dsetname,
-     $ cB,storage_dims,data_dims,rank)
-
-      dsetname = 'Bz'
-      call writehdfrealmat(group_id,dsetname,
-     $ Bz,storage_dims,data_dims,rank)
-
-      dsetname = 'diags'
-      call writehdfintmat(group_id,dsetname,
-     $ diags,storage_dims,data_dims,rank)
-
-      dsetname = 'lplot'
-      call writehdfintmat(group_id,dsetname,
-     $ lplot,storage_dims,data_dims,rank)
-
-      dsetname = 'ldist'
-      call writehdfintmat(group_id,dsetname,
-     $ ldist,storage_dims,data_dims,rank)
-
-      dsetname = 'linsulate'
-      call writehdfintmat(group_id,dsetname,
-     $ linsulate,storage_dims,data_dims,rank)
-
-      dsetname = 'lfloat'
-      call writehdfintmat(group_id,dsetname,
-     $ lfloat,storage_dims,data_dims,rank)
-
-      dsetname = 'lat0'
-      call writehdfintmat(group_id,dsetname,
-     $ lat0,storage_dims,data_dims,rank)
-
-      dsetname = 'lap0'
-      call writehdfintmat(group_id,dsetname,
-     $ lap0,storage_dims,data_dims,rank)
-
-      dsetname = 'localinj'
-      call writehdfintmat(group_id,dsetname,
-     $ localinj,storage_dims,data_dims,rank)
-
-      dsetname = 'lfixedn'
-      call writehdfintmat(group_id,dsetname,
-     $ lfixedn,storage_dims,data_dims,rank)
-
-      dsetname = 'myid'
-      call writehdfintmat(group_id,dsetname,
-     $ myid,storage_dims,data_dims,rank)
-
-      dsetname = 'numprocs'
-      call writehdfintmat(group_id,dsetname,
-     $ numprocs,storage_dims,data_dims,rank)
-
-      dsetname = 'rmtoz'
-      call writehdfrealmat(group_id,dsetname,
-     $ rmtoz,storage_dims,data_dims,rank)
-
-c     Variable arrays
-      dsetname = 'xp'
-      rank = 2
-      data_dims(1) = ndim
-      data_dims(2) = npart
-      storage_dims(1) = ndim
-      storage_dims(2) = npartmax
-      call writehdfrealmat(group_id,dsetname,
-     $  xp,storage_dims,data_dims,rank)
-
-      dsetname = 'vzinit'
-      rank = 1
-      data_dims(1) = npart
-      storage_dims(1) = npartmax
-      call writehdfrealmat(group_id,dsetname,
-     $  vzinit,storage_dims,data_dims,rank)
-
-      dsetname = 'dtprec'
-      rank = 1
-      data_dims(1) = npart
-      storage_dims(1) = npartmax
-      call writehdfrealmat(group_id,dsetname,
-     $  dtprec,storage_dims,data_dims,rank)
-
-      dsetname = 'ipf'
-      rank = 1
-      data_dims(1) = npart
-      storage_dims(1) = npartmax
-      call writehdfintmat(group_id,dsetname,
-     $  ipf,storage_dims,data_dims,rank)
-
-      dsetname = 'phi'
-      rank = 3
-      data_dims(1) = nr+1
-      data_dims(2) = nth+1
-      data_dims(3) = npsi+1
-      storage_dims(1) = nrsize+1
-      storage_dims(2) = nthsize+1
-      storage_dims(3) = npsisize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  phi,storage_dims,data_dims,rank)
-
-      dsetname = 'phiaxis'
-      rank = 2
-      data_dims(1) = nr+1
-      data_dims(2) = npsi+1
-      storage_dims(1) = nrsize
-      storage_dims(2) = npsisize
-      call writehdfrealmat(group_id,dsetname,
-     $  phiaxis,storage_dims,data_dims,rank)
-
-      dsetname = 'rho'
-      rank = 3
-      data_dims(1) = nr+1
-      data_dims(2) = nth+1
-      data_dims(3) = npsi+1
-      storage_dims(1) = nrsize+1
-      storage_dims(2) = nthsize+1
-      storage_dims(3) = npsisize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  rho,storage_dims,data_dims,rank)
-
-      dsetname = 'rhoDiag'
-      rank = 3
-      data_dims(1) = nr+1
-      data_dims(2) = nth+1
-      data_dims(3) = npsi+1
-      storage_dims(1) = nrsize+1
-      storage_dims(2) = nthsize+1
-      storage_dims(3) = npsisize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  rhoDiag,storage_dims,data_dims,rank)
-
-c Close the group.
+c piccom
+      CALL h5gcreate_f(file_id, 'piccom', group_id, error)
+      call hdfiattr(group_id,'npart',npart)
+      call hdfiattr(group_id,'nr',nr)
+      call hdfiattr(group_id,'nth',nth)
+      call hdfiattr(group_id,'npsi',npsi)
+      call hdflattr(group_id,'lsubcycle',lsubcycle)
+      call hdflattr(group_id,'verlet',verlet)
+      call hdflattr(group_id,'LCIC',LCIC)
+      call hdflattr(group_id,'collcic',collcic)
+      call hdfiattr(group_id,'NRUSED',NRUSED)
+      call hdfiattr(group_id,'NTHUSED',NTHUSED)
+      call hdfiattr(group_id,'NPSIUSED',NPSIUSED)
+      call hdfiattr(group_id,'NRFULL',NRFULL)
+      call hdfiattr(group_id,'NTHFULL',NTHFULL)
+      call hdfiattr(group_id,'NPSIFULL',NPSIFULL)
+      call hdfiattr(group_id,'ninjcomp',ninjcomp)
+      call hdfiattr(group_id,'iocprev',iocprev)
+      call hdfattr(group_id,'cerr',cerr)
+      call hdfattr(group_id,'bdyfc',bdyfc)
+      call hdfattr(group_id,'Ti',Ti)
+      call hdfattr(group_id,'vd',vd)
+      call hdfattr(group_id,'cd',cd)
+      call hdfattr(group_id,'cB',cB)
+      call hdfattr(group_id,'Bz',Bz)
+      call hdflattr(group_id,'diags',diags)
+      call hdflattr(group_id,'lplot',lplot)
+      call hdflattr(group_id,'ldist',ldist)
+      call hdflattr(group_id,'linsulate',linsulate)
+      call hdflattr(group_id,'lfloat',lfloat)
+      call hdflattr(group_id,'lat0',lat0)
+      call hdflattr(group_id,'lap0',lap0)
+      call hdflattr(group_id,'localinj',localinj)
+      call hdflattr(group_id,'lfixedn',lfixedn)
+      call hdfiattr(group_id,'myid',myid)
+      call hdfiattr(group_id,'numprocs',numprocs)
+      call hdfattr(group_id,'rmtoz',rmtoz)
+c     Particle slots in use, 1 to iocprev
+      idims(1)=ndim
+      idims(2)=max(iocprev,1)
+      call hdfreal(group_id,'xp',xp,2,idims,' ')
+      idims(1)=max(iocprev,1)
+      call hdfreal(group_id,'vzinit',vzinit,1,idims,' ')
+      call hdfreal(group_id,'dtprec',dtprec,1,idims,' ')
+      call hdfint(group_id,'ipf',ipf,1,idims,' ')
+c     Node arrays, 0:nrused,0:nthused,0:npsiused
+      allocate(w3(n1,n2,n3,3))
+      w3(:,:,:,1)=phi(0:NRUSED,0:NTHUSED,0:NPSIUSED)
+      w3(:,:,:,2)=rho(0:NRUSED,0:NTHUSED,0:NPSIUSED)
+      w3(:,:,:,3)=rhoDiag(0:NRUSED,0:NTHUSED,0:NPSIUSED)
+      idims(1)=n1
+      idims(2)=n2
+      idims(3)=n3
+      idims(4)=3
+      call hdfreal(group_id,'grid',w3,4,idims,'phi rho rhoDiag')
+      deallocate(w3)
+      idims(2)=2
+      call hdfreal(group_id,'phiaxis',phiaxis(0:NRUSED,:,0:NPSIUSED),
+     $     3,idims,' ')
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'momcom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Variable arrays
-      rank = 3
-      data_dims(1) = nr-1
-      data_dims(2) = nth-1
-      data_dims(3) = npsi-1
-      storage_dims(1) = nrsize-1
-      storage_dims(2) = nthsize-1
-      storage_dims(3) = npsisize-1
-
-      dsetname = 'psum'
-      call writehdfrealmat(group_id,dsetname,
-     $  psum,storage_dims,data_dims,rank)
-
-      dsetname = 'vrsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vtsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vtsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vpsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vpsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vr2sum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vr2sum,storage_dims,data_dims,rank)
-
-      dsetname = 'vt2sum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vt2sum,storage_dims,data_dims,rank)
-
-      dsetname = 'vp2sum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vp2sum,storage_dims,data_dims,rank)
-
-      dsetname = 'vrtsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrtsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vrpsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrpsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vtpsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vtpsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vxsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vxsum,storage_dims,data_dims,rank)
-
-      dsetname = 'vysum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vysum,storage_dims,data_dims,rank)
-
-      dsetname = 'vzsum'
-      call writehdfrealmat(group_id,dsetname,
-     $  vzsum,storage_dims,data_dims,rank)
-
-      dsetname = 'pDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  pDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vrDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vtDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vtDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vpDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vpDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vr2Diag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vr2Diag,storage_dims,data_dims,rank)
-
-      dsetname = 'vt2Diag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vt2Diag,storage_dims,data_dims,rank)
-
-      dsetname = 'vp2Diag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vp2Diag,storage_dims,data_dims,rank)
-
-      dsetname = 'vrtDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrtDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vrpDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrpDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vtpDiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vtpDiag,storage_dims,data_dims,rank)
-
-      dsetname = 'curr'
-      rank = 1
-      data_dims(1) = 4
-      storage_dims(1) = 4
-      call writehdfrealmat(group_id,dsetname,
-     $  curr,storage_dims,data_dims,rank)
-
-c Close the group.
+c momcom: the moment sums and their diagnostic averages on the nodes
+c 1:nrused,1:nthused,1:npsiused
+      CALL h5gcreate_f(file_id, 'momcom', group_id, error)
+      call hdfattrv(group_id,'curr',curr,4)
+      allocate(w3(NRUSED,NTHUSED,NPSIUSED,13))
+      call hdfmom(w3,1,psum)
+      call hdfmom(w3,2,vrsum)
+      call hdfmom(w3,3,vtsum)
+      call hdfmom(w3,4,vpsum)
+      call hdfmom(w3,5,vr2sum)
+      call hdfmom(w3,6,vt2sum)
+      call hdfmom(w3,7,vp2sum)
+      call hdfmom(w3,8,vrtsum)
+      call hdfmom(w3,9,vrpsum)
+      call hdfmom(w3,10,vtpsum)
+      call hdfmom(w3,11,vxsum)
+      call hdfmom(w3,12,vysum)
+      call hdfmom(w3,13,vzsum)
+      idims(1)=NRUSED
+      idims(2)=NTHUSED
+      idims(3)=NPSIUSED
+      idims(4)=13
+      call hdfreal(group_id,'sums',w3,4,idims,'psum vrsum vtsum'
+     $     //' vpsum vr2sum vt2sum vp2sum vrtsum vrpsum vtpsum vxsum'
+     $     //' vysum vzsum')
+      call hdfmom(w3,1,pDiag)
+      call hdfmom(w3,2,vrDiag)
+      call hdfmom(w3,3,vtDiag)
+      call hdfmom(w3,4,vpDiag)
+      call hdfmom(w3,5,vr2Diag)
+      call hdfmom(w3,6,vt2Diag)
+      call hdfmom(w3,7,vp2Diag)
+      call hdfmom(w3,8,vrtDiag)
+      call hdfmom(w3,9,vrpDiag)
+      call hdfmom(w3,10,vtpDiag)
+      idims(4)=10
+      call hdfreal(group_id,'Diag',w3,4,idims,'pDiag vrDiag vtDiag'
+     $     //' vpDiag vr2Diag vt2Diag vp2Diag vrtDiag vrpDiag vtpDiag')
+      deallocate(w3)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'meshcom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'rfac'
-      call writehdfrealmat(group_id,dsetname,
-     $ rfac,storage_dims,data_dims,rank)
-
-      dsetname = 'tfac'
-      call writehdfrealmat(group_id,dsetname,
-     $ tfac,storage_dims,data_dims,rank)
-
-      dsetname = 'pfac'
-      call writehdfrealmat(group_id,dsetname,
-     $ pfac,storage_dims,data_dims,rank)
-
-      dsetname = 'avelim'
-      call writehdfrealmat(group_id,dsetname,
-     $ avelim,storage_dims,data_dims,rank)
-
-      dsetname = 'cgparallel'
-      call writehdfintmat(group_id,dsetname,
-     $ cgparallel,storage_dims,data_dims,rank)
-
-      dsetname = 'idim1'
-      call writehdfintmat(group_id,dsetname,
-     $ idim1,storage_dims,data_dims,rank)
-
-      dsetname = 'idim2'
-      call writehdfintmat(group_id,dsetname,
-     $ idim2,storage_dims,data_dims,rank)
-
-      dsetname = 'idim3'
-      call writehdfintmat(group_id,dsetname,
-     $ idim3,storage_dims,data_dims,rank)
-
-c     Variable arrays
-      dsetname = 'r'
-      rank = 1
-      data_dims(1) = nr+1
-      storage_dims(1) = nrsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  r,storage_dims,data_dims,rank)
-
-      dsetname = 'rcc'
-      rank = 1
-      data_dims(1) = nr+1
-      storage_dims(1) = nrsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  rcc,storage_dims,data_dims,rank)
-
-      dsetname = 'th'
-      rank = 1
-      data_dims(1) = nth+1
-      storage_dims(1) = nthsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  th,storage_dims,data_dims,rank)
-
-      dsetname = 'tcc'
-      rank = 1
-      data_dims(1) = nth+1
-      storage_dims(1) = nthsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  tcc,storage_dims,data_dims,rank)
-
-      dsetname = 'thang'
-      rank = 1
-      data_dims(1) = nth+1
-      storage_dims(1) = nthsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  thang,storage_dims,data_dims,rank)
-
-      dsetname = 'pcc'
-      rank = 1
-      data_dims(1) = npsi+1
-      storage_dims(1) = npsisize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  pcc,storage_dims,data_dims,rank)
-
-      dsetname = 'volinv'
-      rank = 1
-      data_dims(1) = nr+1
-      storage_dims(1) = nrsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  volinv,storage_dims,data_dims,rank)
-
-      dsetname = 'irpre'
-      rank = 1
-      data_dims(1) = 4*nr
-      storage_dims(1) = nrpre
-      call writehdfintmat(group_id,dsetname,
-     $  irpre,storage_dims,data_dims,rank)
-
-      dsetname = 'itpre'
-      rank = 1
-      data_dims(1) = 4*nth
-      storage_dims(1) = ntpre
-      call writehdfintmat(group_id,dsetname,
-     $  itpre,storage_dims,data_dims,rank)
-
-      dsetname = 'ippre'
-      rank = 1
-      data_dims(1) = 4*npsi
-      storage_dims(1) = nppre
-      call writehdfintmat(group_id,dsetname,
-     $  ippre,storage_dims,data_dims,rank)
-
-      dsetname = 'hr'
-      rank = 1
-      data_dims(1) = nr+2
-      storage_dims(1) = nrsize+2
-      call writehdfrealmat(group_id,dsetname,
-     $  hr,storage_dims,data_dims,rank)
-
-      dsetname = 'zeta'
-      rank = 1
-      data_dims(1) = nr+2
-      storage_dims(1) = nrsize+2
-      call writehdfrealmat(group_id,dsetname,
-     $  zeta,storage_dims,data_dims,rank)
-
-      dsetname = 'zetahalf'
-      rank = 1
-      data_dims(1) = nr+2
-      storage_dims(1) = nrsize+2
-      call writehdfrealmat(group_id,dsetname,
-     $  zetahalf,storage_dims,data_dims,rank)
-
-      dsetname = 'cminus'
-      rank = 1
-      data_dims(1) = nr
-      storage_dims(1) = nrsize
-      call writehdfrealmat(group_id,dsetname,
-     $  cminus,storage_dims,data_dims,rank)
-
-      dsetname = 'cmid'
-      rank = 1
-      data_dims(1) = nr
-      storage_dims(1) = nrsize
-      call writehdfrealmat(group_id,dsetname,
-     $  cmid,storage_dims,data_dims,rank)
-
-      dsetname = 'cplus'
-      rank = 1
-      data_dims(1) = nr
-      storage_dims(1) = nrsize
-      call writehdfrealmat(group_id,dsetname,
-     $  cplus,storage_dims,data_dims,rank)
-
-c Close the group.
+c meshcom
+      CALL h5gcreate_f(file_id, 'meshcom', group_id, error)
+      call hdfattr(group_id,'rfac',rfac)
+      call hdfattr(group_id,'tfac',tfac)
+      call hdfattr(group_id,'pfac',pfac)
+      call hdfattr(group_id,'avelim',avelim)
+      call hdflattr(group_id,'cgparallel',cgparallel)
+      call hdfiattr(group_id,'idim1',idim1)
+      call hdfiattr(group_id,'idim2',idim2)
+      call hdfiattr(group_id,'idim3',idim3)
+      allocate(w1(max(n1+1,n2),3))
+      w1(1:n1,1)=r(0:NRUSED)
+      w1(1:n1,2)=rcc(0:NRUSED)
+      w1(1:n1,3)=volinv(0:NRUSED)
+      idims(1)=n1
+      idims(2)=3
+      call hdfreal(group_id,'rmesh',w1(1:n1,:),2,idims,
+     $     'r rcc volinv')
+      w1(1:n2,1)=th(0:NTHUSED)
+      w1(1:n2,2)=tcc(0:NTHUSED)
+      w1(1:n2,3)=thang(0:NTHUSED)
+      idims(1)=n2
+      call hdfreal(group_id,'thmesh',w1(1:n2,:),2,idims,
+     $     'th tcc thang')
+      w1(1:n1+1,1)=hr(0:NRUSED+1)
+      w1(1:n1+1,2)=zeta(0:NRUSED+1)
+      w1(1:n1+1,3)=zetahalf(0:NRUSED+1)
+      idims(1)=n1+1
+      call hdfreal(group_id,'hrmesh',w1(1:n1+1,:),2,idims,
+     $     'hr zeta zetahalf')
+      w1(1:NRUSED,1)=cminus(1:NRUSED)
+      w1(1:NRUSED,2)=cmid(1:NRUSED)
+      w1(1:NRUSED,3)=cplus(1:NRUSED)
+      idims(1)=NRUSED
+      call hdfreal(group_id,'cmesh',w1(1:NRUSED,:),2,idims,
+     $     'cminus cmid cplus')
+      deallocate(w1)
+      idims(1)=n3
+      call hdfreal(group_id,'pcc',pcc(0:NPSIUSED),1,idims,' ')
+      idims(1)=4*NRUSED
+      call hdfint(group_id,'irpre',irpre,1,idims,' ')
+      idims(1)=4*NTHUSED
+      call hdfint(group_id,'itpre',itpre,1,idims,' ')
+      idims(1)=4*NPSIUSED
+      call hdfint(group_id,'ippre',ippre,1,idims,' ')
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'rancom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'bcphi'
-      call writehdfintmat(group_id,dsetname,
-     $ bcphi,storage_dims,data_dims,rank)
-
-      dsetname = 'bcr'
-      call writehdfintmat(group_id,dsetname,
-     $ bcr,storage_dims,data_dims,rank)
-
-      dsetname = 'infdbl'
-      call writehdfintmat(group_id,dsetname,
-     $ infdbl,storage_dims,data_dims,rank)
-
-c     Variable arrays
-      dsetname = 'Qcom'
-      rank = 1
-      data_dims(1) = nQth
-      storage_dims(1) = nQth
-      call writehdfrealmat(group_id,dsetname,
-     $  Qcom,storage_dims,data_dims,rank)
-
-      dsetname = 'Gcom'
-      rank = 2
-      data_dims(1) = nvel
-      data_dims(2) = nQth
-      storage_dims(1) = nvel
-      storage_dims(2) = nQth
-      call writehdfrealmat(group_id,dsetname,
-     $  Gcom,storage_dims,data_dims,rank)
-
-      dsetname = 'Vcom'
-      rank = 1
-      data_dims(1) = nvel
-      storage_dims(1) = nvel
-      call writehdfrealmat(group_id,dsetname,
-     $  Vcom,storage_dims,data_dims,rank)
-
-      dsetname = 'pu1'
-      rank = 1
-      data_dims(1) = nvel
-      storage_dims(1) = nvel
-      call writehdfrealmat(group_id,dsetname,
-     $  pu1,storage_dims,data_dims,rank)
-
-      dsetname = 'pu2'
-      rank = 1
-      data_dims(1) = nQth
-      storage_dims(1) = nQth
-      call writehdfrealmat(group_id,dsetname,
-     $  pu2,storage_dims,data_dims,rank)
-
-      dsetname = 'Pc'
-      rank = 2
-      data_dims(1) = nQth
-      data_dims(2) = nvel
-      storage_dims(1) = nQth
-      storage_dims(2) = nvel
-      call writehdfrealmat(group_id,dsetname,
-     $  Pc,storage_dims,data_dims,rank)
-
-c Close the group.
+c rancom
+      CALL h5gcreate_f(file_id, 'rancom', group_id, error)
+      call hdfiattr(group_id,'bcphi',bcphi)
+      call hdfiattr(group_id,'bcr',bcr)
+      call hdflattr(group_id,'infdbl',infdbl)
+      idims(1)=nQth
+      call hdfreal(group_id,'Qcom',Qcom,1,idims,' ')
+      idims(1)=nvel
+      idims(2)=nQth
+      call hdfreal(group_id,'Gcom',Gcom,2,idims,' ')
+      idims(1)=nQth
+      idims(2)=nvel
+      call hdfreal(group_id,'Pc',Pc,2,idims,' ')
+      allocate(w1(nvel,3))
+      w1(:,1)=Vcom
+      w1(:,2)=pu1
+      w1(:,3)=pu2
+      idims(1)=nvel
+      idims(2)=3
+      call hdfreal(group_id,'vel',w1,2,idims,'Vcom pu1 pu2')
+      deallocate(w1)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'diagcom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'nrein'
-      call writehdfintmat(group_id,dsetname,
-     $ nrein,storage_dims,data_dims,rank)
-
-      dsetname = 'nreintry'
-      call writehdfintmat(group_id,dsetname,
-     $ nreintry,storage_dims,data_dims,rank)
-
-      dsetname = 'ninner'
-      call writehdfintmat(group_id,dsetname,
-     $ ninner,storage_dims,data_dims,rank)
-
-      dsetname = 'vrange'
-      call writehdfrealmat(group_id,dsetname,
-     $ vrange,storage_dims,data_dims,rank)
-
-      dsetname = 'phiout'
-      call writehdfrealmat(group_id,dsetname,
-     $ phiout,storage_dims,data_dims,rank)
-
-      dsetname = 'zmomprobe'
-      call writehdfrealmat(group_id,dsetname,
-     $ zmomprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'xmomprobe'
-      call writehdfrealmat(group_id,dsetname,
-     $ xmomprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'ymomprobe'
-      call writehdfrealmat(group_id,dsetname,
-     $ ymomprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'enerprobe'
-      call writehdfrealmat(group_id,dsetname,
-     $ enerprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'zmout'
-      call writehdfrealmat(group_id,dsetname,
-     $ zmout,storage_dims,data_dims,rank)
-
-      dsetname = 'xmout'
-      call writehdfrealmat(group_id,dsetname,
-     $ xmout,storage_dims,data_dims,rank)
-
-      dsetname = 'ymout'
-      call writehdfrealmat(group_id,dsetname,
-     $ ymout,storage_dims,data_dims,rank)
-
-      dsetname = 'bohm'
-      call writehdfintmat(group_id,dsetname,
-     $ bohm,storage_dims,data_dims,rank)
-
-      dsetname = 'spotrein'
-      call writehdfrealmat(group_id,dsetname,
-     $ spotrein,storage_dims,data_dims,rank)
-
-      dsetname = 'averein'
-      call writehdfrealmat(group_id,dsetname,
-     $ averein,storage_dims,data_dims,rank)
-
-      dsetname = 'fluxrein'
-      call writehdfrealmat(group_id,dsetname,
-     $ fluxrein,storage_dims,data_dims,rank)
-
-      dsetname = 'rhoinf'
-      call writehdfrealmat(group_id,dsetname,
-     $ rhoinf,storage_dims,data_dims,rank)
-
-      dsetname = 'ntrapre'
-      call writehdfintmat(group_id,dsetname,
-     $ ntrapre,storage_dims,data_dims,rank)
-
-      dsetname = 'adeficit'
-      call writehdfrealmat(group_id,dsetname,
-     $ adeficit,storage_dims,data_dims,rank)
-
-      dsetname = 'ircell'
-      call writehdfintmat(group_id,dsetname,
-     $ ircell,storage_dims,data_dims,rank)
-
-      dsetname = 'itcell'
-      call writehdfintmat(group_id,dsetname,
-     $ itcell,storage_dims,data_dims,rank)
-
-c     Variable arrays
-      rank = 1
-      data_dims(1) = nvmax
-      storage_dims(1) = nvmax
-      dsetname = 'nvdiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  nvdiag,storage_dims,data_dims,rank)
-
-      dsetname = 'nvdiagave'
-      call writehdfrealmat(group_id,dsetname,
-     $  nvdiagave,storage_dims,data_dims,rank)
-
-      dsetname = 'vdiag'
-      call writehdfrealmat(group_id,dsetname,
-     $  vdiag,storage_dims,data_dims,rank)
-
-      dsetname = 'vrdiagin'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrdiagin,storage_dims,data_dims,rank)
-
-      dsetname = 'vtdiagin'
-      call writehdfrealmat(group_id,dsetname,
-     $  vtdiagin,storage_dims,data_dims,rank)
-
-      rank = 1
-      data_dims(1) = nr
-      storage_dims(1) = nrsize
-      dsetname = 'diagrho'
-      call writehdfrealmat(group_id,dsetname,
-     $  diagrho,storage_dims,data_dims,rank)
-
-      dsetname = 'diagphi'
-      call writehdfrealmat(group_id,dsetname,
-     $  diagphi,storage_dims,data_dims,rank)
-
-      dsetname = 'diagchi'
-      rank = 1
-      data_dims(1) = nth+1
-      storage_dims(1) = nthsize+1
-      call writehdfrealmat(group_id,dsetname,
-     $  diagchi,storage_dims,data_dims,rank)
-
-      dsetname = 'fluxprobe'
-      rank = 1
-      data_dims(1) = maxsteps
-      storage_dims(1) = nstepmax
-      call writehdfrealmat(group_id,dsetname,
-     $  fluxprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'zmom'
-      rank = 3
-      data_dims(1) = maxsteps
-      data_dims(2) = 5
-      data_dims(3) = 2
-      storage_dims(1) = nstepmax
-      storage_dims(2) = 5
-      storage_dims(3) = 2
-      call writehdfrealmat(group_id,dsetname,
-     $  zmom,storage_dims,data_dims,rank)
-
-      dsetname = 'xmom'
-      rank = 3
-      data_dims(1) = maxsteps
-      data_dims(2) = 4
-      data_dims(3) = 2
-      storage_dims(1) = nstepmax
-      storage_dims(2) = 4
-      storage_dims(3) = 2
-      call writehdfrealmat(group_id,dsetname,
-     $  xmom,storage_dims,data_dims,rank)
-
-      dsetname = 'ymom'
-      rank = 3
-      data_dims(1) = maxsteps
-      data_dims(2) = 4
-      data_dims(3) = 2
-      storage_dims(1) = nstepmax
-      storage_dims(2) = 4
-      storage_dims(3) = 2
-      call writehdfrealmat(group_id,dsetname,
-     $  ymom,storage_dims,data_dims,rank)
-
-      dsetname = 'enertot'
-      rank = 1
-      data_dims(1) = maxsteps
-      storage_dims(1) = nstepmax
-      call writehdfrealmat(group_id,dsetname,
-     $  enertot,storage_dims,data_dims,rank)
-
-      rank = 3
-      data_dims(1) = nth
-      data_dims(2) = npsi
-      data_dims(3) = maxsteps+1
-      storage_dims(1) = nthsize
-      storage_dims(2) = npsisize
-      storage_dims(3) = nstepmax+1
-      dsetname = 'nincellstep'
-      call writehdfrealmat(group_id,dsetname,
-     $  nincellstep,storage_dims,data_dims,rank)
-
-      dsetname = 'vrincellstep'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrincellstep,storage_dims,data_dims,rank)
-
-      dsetname = 'vr2incellstep'
-      call writehdfrealmat(group_id,dsetname,
-     $  vr2incellstep,storage_dims,data_dims,rank)
-
-      rank = 2
-      data_dims(1) = nth
-      data_dims(2) = npsi
-      storage_dims(1) = nthsize
-      storage_dims(2) = npsisize
-      dsetname = 'nincell'
-      call writehdfrealmat(group_id,dsetname,
-     $  nincell,storage_dims,data_dims,rank)
-
-      dsetname = 'vrincell'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrincell,storage_dims,data_dims,rank)
-
-      dsetname = 'vr2incell'
-      call writehdfrealmat(group_id,dsetname,
-     $  vr2incell,storage_dims,data_dims,rank)
-
-      dsetname = 'fincellave'
-      call writehdfrealmat(group_id,dsetname,
-     $  fincellave,storage_dims,data_dims,rank)
-
-      dsetname = 'vrincellave'
-      call writehdfrealmat(group_id,dsetname,
-     $  vrincellave,storage_dims,data_dims,rank)
-
-      dsetname = 'vr2incellave'
-      call writehdfrealmat(group_id,dsetname,
-     $  vr2incellave,storage_dims,data_dims,rank)
-
-c Close the group.
+c diagcom
+      CALL h5gcreate_f(file_id, 'diagcom', group_id, error)
+      call hdfiattr(group_id,'nrein',nrein)
+      call hdfiattr(group_id,'nreintry',nreintry)
+      call hdfiattr(group_id,'ninner',ninner)
+      call hdfattr(group_id,'vrange',vrange)
+      call hdfattr(group_id,'phiout',phiout)
+      call hdfattr(group_id,'zmomprobe',zmomprobe)
+      call hdfattr(group_id,'xmomprobe',xmomprobe)
+      call hdfattr(group_id,'ymomprobe',ymomprobe)
+      call hdfattr(group_id,'enerprobe',enerprobe)
+      call hdfattr(group_id,'zmout',zmout)
+      call hdfattr(group_id,'xmout',xmout)
+      call hdfattr(group_id,'ymout',ymout)
+      call hdflattr(group_id,'bohm',bohm)
+      call hdfattr(group_id,'spotrein',spotrein)
+      call hdfattr(group_id,'averein',averein)
+      call hdfattr(group_id,'fluxrein',fluxrein)
+      call hdfattr(group_id,'rhoinf',rhoinf)
+      call hdfiattr(group_id,'ntrapre',ntrapre)
+      call hdfattr(group_id,'adeficit',adeficit)
+      call hdfiattr(group_id,'ircell',ircell)
+      call hdfiattr(group_id,'itcell',itcell)
+      allocate(w1(nvmax,5))
+      w1(:,1)=nvdiag
+      w1(:,2)=nvdiagave
+      w1(:,3)=vdiag
+      w1(:,4)=vrdiagin
+      w1(:,5)=vtdiagin
+      idims(1)=nvmax
+      idims(2)=5
+      call hdfreal(group_id,'vdiags',w1,2,idims,
+     $     'nvdiag nvdiagave vdiag vrdiagin vtdiagin')
+      deallocate(w1)
+      allocate(w1(NRUSED,2))
+      w1(:,1)=diagrho(1:NRUSED)
+      w1(:,2)=diagphi(1:NRUSED)
+      idims(1)=NRUSED
+      idims(2)=2
+      call hdfreal(group_id,'radial',w1,2,idims,'diagrho diagphi')
+      deallocate(w1)
+      idims(1)=n2
+      call hdfreal(group_id,'diagchi',diagchi(0:NTHUSED),1,idims,' ')
+c     Step histories, 1:maxsteps
+      ns=max(maxsteps,1)
+      allocate(w1(ns,2))
+      w1(:,1)=fluxprobe(1:ns)
+      w1(:,2)=enertot(1:ns)
+      idims(1)=ns
+      idims(2)=2
+      call hdfreal(group_id,'steps',w1,2,idims,'fluxprobe enertot')
+      deallocate(w1)
+      idims(2)=5
+      idims(3)=2
+      call hdfreal(group_id,'zmom',zmom(1:ns,:,:),3,idims,' ')
+      idims(2)=4
+      call hdfreal(group_id,'xmom',xmom(1:ns,:,:),3,idims,' ')
+      call hdfreal(group_id,'ymom',ymom(1:ns,:,:),3,idims,' ')
+c     Cell histories, steps 0:maxsteps
+      allocate(w3(NTHUSED,NPSIUSED,ns+1,3))
+      w3(:,:,:,1)=nincellstep(1:NTHUSED,1:NPSIUSED,0:ns)
+      w3(:,:,:,2)=vrincellstep(1:NTHUSED,1:NPSIUSED,0:ns)
+      w3(:,:,:,3)=vr2incellstep(1:NTHUSED,1:NPSIUSED,0:ns)
+      idims(1)=NTHUSED
+      idims(2)=NPSIUSED
+      idims(3)=ns+1
+      idims(4)=3
+      call hdfreal(group_id,'incellstep',w3,4,idims,
+     $     'nincellstep vrincellstep vr2incellstep')
+      deallocate(w3)
+      allocate(w2(NTHUSED,NPSIUSED,6))
+      w2(:,:,1)=nincell(1:NTHUSED,1:NPSIUSED)
+      w2(:,:,2)=vrincell(1:NTHUSED,1:NPSIUSED)
+      w2(:,:,3)=vr2incell(1:NTHUSED,1:NPSIUSED)
+      w2(:,:,4)=fincellave(1:NTHUSED,1:NPSIUSED)
+      w2(:,:,5)=vrincellave(1:NTHUSED,1:NPSIUSED)
+      w2(:,:,6)=vr2incellave(1:NTHUSED,1:NPSIUSED)
+      idims(3)=6
+      call hdfreal(group_id,'incell',w2,3,idims,'nincell vrincell'
+     $     //' vr2incell fincellave vrincellave vr2incellave')
+      deallocate(w2)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'poisson'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'debyelen'
-      call writehdfrealmat(group_id,dsetname,
-     $ debyelen,storage_dims,data_dims,rank)
-
-      dsetname = 'vprobe'
-      call writehdfrealmat(group_id,dsetname,
-     $ vprobe,storage_dims,data_dims,rank)
-
-      dsetname = 'Ezext'
-      call writehdfrealmat(group_id,dsetname,
-     $ Ezext,storage_dims,data_dims,rank)
-
-      dsetname = 'lbcg'
-      call writehdfintmat(group_id,dsetname,
-     $ lbcg,storage_dims,data_dims,rank)
-
-c     Variable arrays
-      rank = 1
-      data_dims(1) = nr+1
-      storage_dims(1) = nrsize+1
-      dsetname = 'apc'
-      call writehdfrealmat(group_id,dsetname,
-     $  apc,storage_dims,data_dims,rank)
-
-      dsetname = 'bpc'
-      call writehdfrealmat(group_id,dsetname,
-     $  bpc,storage_dims,data_dims,rank)
-
-      rank = 2
-      data_dims(1) = nr+1
-      data_dims(2) = nth+1
-      storage_dims(1) = nrsize+1
-      storage_dims(2) = nthsize+1
-      dsetname = 'cpc'
-      call writehdfrealmat(group_id,dsetname,
-     $  cpc,storage_dims,data_dims,rank)
-
-      dsetname = 'dpc'
-      call writehdfrealmat(group_id,dsetname,
-     $  dpc,storage_dims,data_dims,rank)
-
-      dsetname = 'epc'
-      call writehdfrealmat(group_id,dsetname,
-     $  epc,storage_dims,data_dims,rank)
-
-      dsetname = 'fpc'
-      call writehdfrealmat(group_id,dsetname,
-     $  fpc,storage_dims,data_dims,rank)
-
-      dsetname = 'gpc'
-      rank = 3
-      data_dims(1) = nth+1
-      data_dims(2) = npsi+1
-      data_dims(3) = 5
-      storage_dims(1) = nthsize+1
-      storage_dims(2) = npsisize+1
-      storage_dims(3) = 5
-      call writehdfrealmat(group_id,dsetname,
-     $  gpc,storage_dims,data_dims,rank)
-
-c Close the group.
+c poisson
+      CALL h5gcreate_f(file_id, 'poisson', group_id, error)
+      call hdfattr(group_id,'debyelen',debyelen)
+      call hdfattr(group_id,'vprobe',vprobe)
+      call hdfattr(group_id,'Ezext',Ezext)
+      call hdflattr(group_id,'lbcg',lbcg)
+      allocate(w1(n1,2))
+      w1(:,1)=apc(0:NRUSED)
+      w1(:,2)=bpc(0:NRUSED)
+      idims(1)=n1
+      idims(2)=2
+      call hdfreal(group_id,'abpc',w1,2,idims,'apc bpc')
+      deallocate(w1)
+      allocate(w2(n1,n2,4))
+      w2(:,:,1)=cpc(0:NRUSED,0:NTHUSED)
+      w2(:,:,2)=dpc(0:NRUSED,0:NTHUSED)
+      w2(:,:,3)=epc(0:NRUSED,0:NTHUSED)
+      w2(:,:,4)=fpc(0:NRUSED,0:NTHUSED)
+      idims(2)=n2
+      idims(3)=4
+      call hdfreal(group_id,'cfpc',w2,3,idims,'cpc dpc epc fpc')
+      deallocate(w2)
+      idims(1)=n2
+      idims(2)=n3
+      idims(3)=5
+      call hdfreal(group_id,'gpc',gpc(0:NTHUSED,0:NPSIUSED,:),3,idims,
+     $     ' ')
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'stepave'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'nstepsave'
-      call writehdfintmat(group_id,dsetname,
-     $ nstepsave,storage_dims,data_dims,rank)
-
-      dsetname = 'nsamax'
-      call writehdfintmat(group_id,dsetname,
-     $ nsamax,storage_dims,data_dims,rank)
-
-      dsetname = 'diagsamp'
-      call writehdfintmat(group_id,dsetname,
-     $ diagsamp,storage_dims,data_dims,rank)
-
-      dsetname = 'samp'
-      call writehdfintmat(group_id,dsetname,
-     $ samp,storage_dims,data_dims,rank)
-
-c Close the group.
+c stepave
+      CALL h5gcreate_f(file_id, 'stepave', group_id, error)
+      call hdfiattr(group_id,'nstepsave',nstepsave)
+      call hdfiattr(group_id,'nsamax',nsamax)
+      call hdfiattr(group_id,'diagsamp',diagsamp)
+      call hdflattr(group_id,'samp',samp)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'orbits'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'norbits'
-      call writehdfintmat(group_id,dsetname,
-     $ norbits,storage_dims,data_dims,rank)
-
-c     Variable arrays
+c orbits
+      CALL h5gcreate_f(file_id, 'orbits', group_id, error)
+      call hdfiattr(group_id,'norbits',norbits)
       if (norbits.gt.0) then
-
-      rank = 2
-      data_dims(1) = maxsteps
-      data_dims(2) = norbits
-      storage_dims(1) = nstepmax
-      storage_dims(2) = nobsmax
-      dsetname = 'xorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  xorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'yorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  yorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'zorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  zorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'vxorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  vxorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'vyorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  vyorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'vzorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  vzorbit,storage_dims,data_dims,rank)
-
-      dsetname = 'rorbit'
-      call writehdfrealmat(group_id,dsetname,
-     $  rorbit,storage_dims,data_dims,rank)
-
-      rank = 1
-      data_dims(1) = norbits
-      storage_dims(1) = nobsmax
-      dsetname = 'iorbitlen'
-      call writehdfintmat(group_id,dsetname,
-     $  iorbitlen,storage_dims,data_dims,rank)
-
+         allocate(w2(ns,norbits,7))
+         w2(:,:,1)=xorbit(1:ns,1:norbits)
+         w2(:,:,2)=yorbit(1:ns,1:norbits)
+         w2(:,:,3)=zorbit(1:ns,1:norbits)
+         w2(:,:,4)=vxorbit(1:ns,1:norbits)
+         w2(:,:,5)=vyorbit(1:ns,1:norbits)
+         w2(:,:,6)=vzorbit(1:ns,1:norbits)
+         w2(:,:,7)=rorbit(1:ns,1:norbits)
+         idims(1)=ns
+         idims(2)=norbits
+         idims(3)=7
+         call hdfreal(group_id,'orbit',w2,3,idims,'xorbit yorbit'
+     $        //' zorbit vxorbit vyorbit vzorbit rorbit')
+         deallocate(w2)
+         idims(1)=norbits
+         call hdfint(group_id,'iorbitlen',iorbitlen,1,idims,' ')
       endif
-
-c Close the group.
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'orbtrack'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'orbinit'
-      call writehdfintmat(group_id,dsetname,
-     $ orbinit,storage_dims,data_dims,rank)
-
-      dsetname = 'maxsteps'
-      call writehdfintmat(group_id,dsetname,
-     $ maxsteps,storage_dims,data_dims,rank)
-
-      dsetname = 'trackinit'
-      call writehdfintmat(group_id,dsetname,
-     $ trackinit,storage_dims,data_dims,rank)
-
-c Close the group.
+c orbtrack
+      CALL h5gcreate_f(file_id, 'orbtrack', group_id, error)
+      call hdflattr(group_id,'orbinit',orbinit)
+      call hdfiattr(group_id,'maxsteps',maxsteps)
+      call hdfiattr(group_id,'trackinit',trackinit)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'err'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'lgotooutput'
-      call writehdfintmat(group_id,dsetname,
-     $ lgotooutput,storage_dims,data_dims,rank)
-
-      dsetname = 'lsavephi'
-      call writehdfintmat(group_id,dsetname,
-     $ lsavephi,storage_dims,data_dims,rank)
-
+c err
+      CALL h5gcreate_f(file_id, 'err', group_id, error)
+      call hdflattr(group_id,'lgotooutput',lgotooutput)
+      call hdflattr(group_id,'lsavephi',lsavephi)
       if (stepcount .lt. saveatstep) then
          lsavemat = .false.
       endif
-
-      dsetname = 'lsavemat'
-      call writehdfintmat(group_id,dsetname,
-     $ lsavemat,storage_dims,data_dims,rank)
-
-      dsetname = 'stepcount'
-      call writehdfintmat(group_id,dsetname,
-     $ stepcount,storage_dims,data_dims,rank)
-
-      dsetname = 'saveatstep'
-      call writehdfintmat(group_id,dsetname,
-     $ saveatstep,storage_dims,data_dims,rank)
-
-      dsetname = 'rshieldingsave'
-      call writehdfintmat(group_id,dsetname,
-     $ rshieldingsave,storage_dims,data_dims,rank)
-
-c     Variable arrays
+      call hdflattr(group_id,'lsavemat',lsavemat)
+      call hdfiattr(group_id,'stepcount',stepcount)
+      call hdfiattr(group_id,'saveatstep',saveatstep)
+      call hdfiattr(group_id,'rshieldingsave',rshieldingsave)
       if (lsavephi) then
-
-      dsetname = 'phisave'
-      rank = 4
-      data_dims(1) = nr+1
-      data_dims(2) = nth+1
-      data_dims(3) = npsi+1
-      data_dims(4) = min(maxsteps,nstepssave)
-      storage_dims(1) = nrsizesave+1
-      storage_dims(2) = nthsizesave+1
-      storage_dims(3) = npsisizesave+1
-      storage_dims(4) = nstepssave
-      call writehdfrealmat(group_id,dsetname,
-     $  phisave,storage_dims,data_dims,rank)
-
-      dsetname = 'phiaxissave'
-      rank = 4
-      data_dims(1) = nr+1
-      data_dims(2) = 2
-      data_dims(3) = npsi+1
-      data_dims(4) = min(maxsteps,nstepssave)
-      storage_dims(1) = nrsizesave+1
-      storage_dims(2) = 2
-      storage_dims(3) = npsisizesave+1
-      storage_dims(4) = nstepssave
-      call writehdfrealmat(group_id,dsetname,
-     $  phiaxissave,storage_dims,data_dims,rank)
-
+         nm=min(maxsteps,nstepssave)
+         idims(1)=n1
+         idims(2)=n2
+         idims(3)=n3
+         idims(4)=nm
+         call hdfreal(group_id,'phisave',
+     $        phisave(0:NRUSED,0:NTHUSED,0:NPSIUSED,1:nm),4,idims,' ')
+         idims(2)=2
+         call hdfreal(group_id,'phiaxissave',
+     $        phiaxissave(0:NRUSED,:,0:NPSIUSED,1:nm),4,idims,' ')
       endif
-
       if (lsavemat) then
-
-      rank = 6
-      data_dims(1) = rshieldingsave
-      data_dims(2) = nth
-      data_dims(3) = npsi
-      data_dims(4) = rshieldingsave
-      data_dims(5) = nth
-      data_dims(6) = npsi
-      storage_dims(1) = nrsizesave
-      storage_dims(2) = nthsizesave
-      storage_dims(3) = npsisizesave
-      storage_dims(4) = nrsizesave
-      storage_dims(5) = nthsizesave
-      storage_dims(6) = npsisizesave
-
-      dsetname = 'Asave'
-      call writehdfrealmat(group_id,dsetname,
-     $  Asave,storage_dims,data_dims,rank)
-
-      dsetname = 'Atsave'
-      call writehdfrealmat(group_id,dsetname,
-     $  Atsave,storage_dims,data_dims,rank)
-
-      rank = 2
-      data_dims(1) = rshieldingsave*nth*npsi
-      data_dims(2) = rshieldingsave*nth*npsi
-      storage_dims(1) = nrsizesave*nthsizesave*npsisizesave
-      storage_dims(2) = nrsizesave*nthsizesave*npsisizesave
-
-      dsetname = 'Amat'
-      call writehdfrealmat(group_id,dsetname,
-     $  Amat,storage_dims,data_dims,rank)
-
-      dsetname = 'Atmat'
-      call writehdfrealmat(group_id,dsetname,
-     $  Atmat,storage_dims,data_dims,rank)
-
-      rank = 3
-      data_dims(1) = rshieldingsave
-      data_dims(2) = nthused+1
-      data_dims(3) = npsiused+1
-      storage_dims(1) = nrsizesave
-      storage_dims(2) = nthsizesave+1
-      storage_dims(3) = npsisizesave+1
-
-      dsetname = 'bsave'
-      call writehdfrealmat(group_id,dsetname,
-     $  bsave,storage_dims,data_dims,rank)
-
-      dsetname = 'xsave'
-      call writehdfrealmat(group_id,dsetname,
-     $  xsave,storage_dims,data_dims,rank)
-
-      rank = 1
-      data_dims(1) = rshieldingsave*nthused*npsiused
-      storage_dims(1) = nrsizesave*(nthsizesave+1)*(npsisizesave+1)
-
-      dsetname = 'bsavevect'
-      call writehdfrealmat(group_id,dsetname,
-     $  bsavevect,storage_dims,data_dims,rank)
-
-      dsetname = 'xsavevect'
-      call writehdfrealmat(group_id,dsetname,
-     $  xsavevect,storage_dims,data_dims,rank)
-
+         nm=rshieldingsave
+         idims(1)=nm
+         idims(2)=nth
+         idims(3)=npsi
+         idims(4)=nm
+         idims(5)=nth
+         idims(6)=npsi
+         call hdfreal(group_id,'Asave',
+     $        Asave(1:nm,1:nth,1:npsi,1:nm,1:nth,1:npsi),6,idims,' ')
+         call hdfreal(group_id,'Atsave',
+     $        Atsave(1:nm,1:nth,1:npsi,1:nm,1:nth,1:npsi),6,idims,' ')
+         nm=rshieldingsave*nth*npsi
+         idims(1)=nm
+         idims(2)=nm
+         call hdfreal(group_id,'Amat',Amat(1:nm,1:nm),2,idims,' ')
+         call hdfreal(group_id,'Atmat',Atmat(1:nm,1:nm),2,idims,' ')
+         nm=rshieldingsave
+         idims(1)=nm
+         idims(2)=NTHUSED+1
+         idims(3)=NPSIUSED+1
+         call hdfreal(group_id,'bsave',
+     $        bsave(1:nm,0:NTHUSED,0:NPSIUSED),3,idims,' ')
+         call hdfreal(group_id,'xsave',
+     $        xsave(1:nm,0:NTHUSED,0:NPSIUSED),3,idims,' ')
+         idims(1)=rshieldingsave*NTHUSED*NPSIUSED
+         call hdfreal(group_id,'bsavevect',bsavevect,1,idims,' ')
+         call hdfreal(group_id,'xsavevect',xsavevect,1,idims,' ')
       endif
-
-c Close the group.
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'colncom'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'vneutral'
-      call writehdfrealmat(group_id,dsetname,
-     $ vneutral,storage_dims,data_dims,rank)
-
-      dsetname = 'Tneutral'
-      call writehdfrealmat(group_id,dsetname,
-     $ Tneutral,storage_dims,data_dims,rank)
-
-      dsetname = 'Eneutral'
-      call writehdfrealmat(group_id,dsetname,
-     $ Eneutral,storage_dims,data_dims,rank)
-
-      dsetname = 'NCneutral'
-      call writehdfintmat(group_id,dsetname,
-     $ NCneutral,storage_dims,data_dims,rank)
-
-c Close the group.
+c colncom
+      CALL h5gcreate_f(file_id, 'colncom', group_id, error)
+      call hdfattr(group_id,'vneutral',vneutral)
+      call hdfattr(group_id,'Tneutral',Tneutral)
+      call hdfattr(group_id,'Eneutral',Eneutral)
+      call hdfiattr(group_id,'NCneutral',NCneutral)
       CALL h5gclose_f(group_id, error)
 
-
-c Create a group in the file.
-      groupname = 'noncommonblock'
-      CALL h5gcreate_f(file_id, groupname, group_id, error)
-
-c Write the data in this group
-
-c     Single value variables
-      rank = 1
-      data_dims(1) = 1
-      storage_dims(1) = 1
-
-      dsetname = 'dt'
-      call writehdfrealmat(group_id,dsetname,
-     $ dt,storage_dims,data_dims,rank)
-
-      dsetname = 'fave'
-      call writehdfrealmat(group_id,dsetname,
-     $ fave,storage_dims,data_dims,rank)
-
-      dsetname = 'colnwt'
-      call writehdfrealmat(group_id,dsetname,
-     $ colnwt,storage_dims,data_dims,rank)
-
-      dsetname = 'icolntype'
-      call writehdfintmat(group_id,dsetname,
-     $ icolntype,storage_dims,data_dims,rank)
-
-c Close the group.
- 999  CALL h5gclose_f(group_id, error)
-
+c Arguments that are not in any common block
+      CALL h5gcreate_f(file_id, 'noncommonblock', group_id, error)
+      call hdfattr(group_id,'dt',dt)
+      call hdfattr(group_id,'fave',fave)
+      call hdfattr(group_id,'colnwt',colnwt)
+      call hdfiattr(group_id,'icolntype',icolntype)
+      CALL h5gclose_f(group_id, error)
 
 c Terminate access to the file.
       CALL h5fclose_f(file_id, error)
-
 c Close FORTRAN interface.
       CALL h5close_f(error)
-
       end
+c*********************************************************************
+c Copy the moment array a, allocated (nrsize-1,nthsize-1,npsisize-1),
+c to the slice m of the batch w of used extents.
+      subroutine hdfmom(w,m,a)
+      implicit none
+      include 'piccom.f'
+      integer m
+      real w(NRUSED,NTHUSED,NPSIUSED,*)
+      real a(nrsize-1,nthsize-1,npsisize-1)
 
-
+      w(:,:,:,m)=a(1:NRUSED,1:NTHUSED,1:NPSIUSED)
+      end
 c*********************************************************************
-c Outputs a real matrix to a specified group in an hdf5 file
-      subroutine writehdfrealmat2(group_id,dsetname,dset_data,
-     $  storage_dims,data_dims,rank)
-c Load the hdf5 module
+c Create the dataset name of type itype and dimensions
+c idims(1:nrank) in group group_id, returning its id. Datasets of more
+c than 1024 elements are chunked, in chunks of up to 64k elements cut
+c across the last dimensions, and shuffled and deflated when the
+c library has zlib. A nonblank names is attached as the attribute
+c 'names'.
+      subroutine hdfdset(group_id,name,itype,nrank,idims,names,
+     $     dset_id)
       use hdf5
-c Don't allow implicit definitions
       implicit none
-c Input variables
-      INTEGER(HID_T) :: group_id
-      CHARACTER(LEN=55) :: dsetname
-      REAL, DIMENSION(*) :: dset_data
-      INTEGER(HSIZE_T), DIMENSION(*) :: data_dims, storage_dims
-      INTEGER     ::   rank
-c Local variables
-      INTEGER(HID_T) :: dataset_id
-      INTEGER(HID_T) :: dataspace_id
-      INTEGER     ::   error
-
-c Create a data space for the dataset.
-      CALL h5screate_simple_f(rank, storage_dims, dataspace_id, error)
-
-c Create a dataset in the group with default properties.
-      CALL h5dcreate_f(group_id, dsetname, H5T_NATIVE_REAL,
-     $  dataspace_id, dataset_id, error)
-
-c Write the dataset.
-      CALL h5dwrite_f(dataset_id, H5T_NATIVE_REAL, dset_data,
-     $  data_dims, error)
-
-c Close the dataspace.
-      CALL h5sclose_f(dataspace_id, error)
-
-c Close the dataset.
-      CALL h5dclose_f(dataset_id, error)
-
+      INTEGER(HID_T) :: group_id,itype,dset_id
+      character*(*) name,names
+      integer nrank,idims(*)
+      INTEGER(HID_T) :: space_id,plist_id
+      INTEGER(HSIZE_T), DIMENSION(6) :: dims,chunk
+      integer error,i,nel,nch
+      logical lzip
+
+      nel=1
+      do i=1,nrank
+         dims(i)=idims(i)
+         chunk(i)=idims(i)
+         nel=nel*idims(i)
+      enddo
+      call h5screate_simple_f(nrank,dims,space_id,error)
+      if(nel.gt.1024)then
+         nch=nel
+         do i=nrank,1,-1
+            if(nch.gt.65536)then
+               nch=nch/idims(i)
+               chunk(i)=max(1,65536/nch)
+               nch=nch*int(chunk(i))
+            endif
+         enddo
+         call h5pcreate_f(H5P_DATASET_CREATE_F,plist_id,error)
+         call h5pset_chunk_f(plist_id,nrank,chunk,error)
+         call h5zfilter_avail_f(H5Z_FILTER_DEFLATE_F,lzip,error)
+         if(lzip)then
+            call h5pset_shuffle_f(plist_id,error)
+            call h5pset_deflate_f(plist_id,4,error)
+         endif
+         call h5dcreate_f(group_id,name,itype,space_id,dset_id,error,
+     $        plist_id)
+         call h5pclose_f(plist_id,error)
+      else
+         call h5dcreate_f(group_id,name,itype,space_id,dset_id,error)
+      endif
+      call h5sclose_f(space_id,error)
+      if(names.ne.' ')call hdfsattr(dset_id,'names',names)
       end
-
 c*********************************************************************
-c Outputs a real matrix to a specified group in an hdf5 file
-      subroutine writehdfrealmat(group_id,dsetname,dset_data,
-     $  storage_dims,data_dims,rank)
-c Load the hdf5 module
+c Write the real array a(idims(1),...,idims(nrank)) as the dataset name
+c of group group_id.
+      subroutine hdfreal(group_id,name,a,nrank,idims,names)
       use hdf5
-c Don't allow implicit definitions
       implicit none
-c Input variables
       INTEGER(HID_T) :: group_id
-      CHARACTER(LEN=55) :: dsetname
-      REAL, DIMENSION(*) :: dset_data
-      INTEGER(HSIZE_T), DIMENSION(*) :: data_dims, storage_dims
-      INTEGER     ::   rank
-c Local variables
-      INTEGER(HID_T) :: dataset_id
-      INTEGER(HID_T) :: dataspace_id, memspace_id
-      INTEGER     ::   error
-c     Hyperslab offset in memory
-      INTEGER(HSIZE_T), DIMENSION(10) :: offset =
-     $  (/0,0,0,0,0,0,0,0,0,0/)
-
-c Create a data space for the dataset.
-      CALL h5screate_simple_f(rank,data_dims,dataspace_id,error)
-
-c Create a data space for the memory (since only part of array used).
-      CALL h5screate_simple_f(rank,storage_dims,memspace_id,error)
-
-c Select hyperslab in memory.
-      CALL h5sselect_hyperslab_f(memspace_id, H5S_SELECT_SET_F,
-     $  offset, data_dims, error)
-
-c Create a dataset in the group with default properties.
-      CALL h5dcreate_f(group_id, dsetname, H5T_NATIVE_REAL,
-     $  dataspace_id, dataset_id, error)
-
-c Write the dataset.
-      CALL h5dwrite_f(dataset_id, H5T_NATIVE_REAL, dset_data,
-     $  data_dims, error, memspace_id)
-
-c Close the dataspace.
-      CALL h5sclose_f(dataspace_id, error)
-
-c Close the dataset.
-      CALL h5dclose_f(dataset_id, error)
-
+      character*(*) name,names
+      integer nrank,idims(*)
+      real a(*)
+      INTEGER(HID_T) :: dset_id
+      INTEGER(HSIZE_T), DIMENSION(6) :: dims
+      integer error,i
+
+      do i=1,nrank
+         dims(i)=idims(i)
+      enddo
+      call hdfdset(group_id,name,H5T_NATIVE_REAL,nrank,idims,names,
+     $     dset_id)
+      call h5dwrite_f(dset_id,H5T_NATIVE_REAL,a,dims,error)
+      call h5dclose_f(dset_id,error)
       end
-
 c*********************************************************************
-c Outputs an integer matrix to a specified group in an hdf5 file
-      subroutine writehdfintmat(group_id,dsetname,dset_data,
-     $  storage_dims,data_dims,rank)
-c Load the hdf5 module
+c Integer version of hdfreal.
+      subroutine hdfint(group_id,name,ia,nrank,idims,names)
       use hdf5
-c Don't allow implicit definitions
       implicit none
-c Input variables
       INTEGER(HID_T) :: group_id
-      CHARACTER(LEN=55) :: dsetname
-      INTEGER, DIMENSION(*) :: dset_data
-      INTEGER(HSIZE_T), DIMENSION(*) :: data_dims, storage_dims
-      INTEGER     ::   rank
-c Local variables
-      INTEGER(HID_T) :: dataset_id
-      INTEGER(HID_T) :: dataspace_id, memspace_id
-      INTEGER     ::   error
-c     Hyperslab offset in memory
-      INTEGER(HSIZE_T), DIMENSION(10) :: offset =
-     $  (/0,0,0,0,0,0,0,0,0,0/)
-
-c Create a data space for the dataset.
-      CALL h5screate_simple_f(rank,data_dims,dataspace_id,error)
-
-c Create a data space for the memory (since only part of array used).
-      CALL h5screate_simple_f(rank,storage_dims,memspace_id,error)
-
-c Select hyperslab in memory.
-      CALL h5sselect_hyperslab_f(memspace_id, H5S_SELECT_SET_F,
-     $  offset, data_dims, error)
-
-c Create a dataset in the group with default properties.
-      CALL h5dcreate_f(group_id, dsetname, H5T_NATIVE_INTEGER,
-     $  dataspace_id, dataset_id, error)
-
-c Write the dataset.
-      CALL h5dwrite_f(dataset_id, H5T_NATIVE_INTEGER, dset_data,
-     $  data_dims, error, memspace_id)
-
-c Close the dataspace.
-      CALL h5sclose_f(dataspace_id, error)
-
-c Close the dataset.
-      CALL h5dclose_f(dataset_id, error)
+      character*(*) name,names
+      integer nrank,idims(*)
+      integer ia(*)
+      INTEGER(HID_T) :: dset_id
+      INTEGER(HSIZE_T), DIMENSION(6) :: dims
+      integer error,i
+
+      do i=1,nrank
+         dims(i)=idims(i)
+      enddo
+      call hdfdset(group_id,name,H5T_NATIVE_INTEGER,nrank,idims,names,
+     $     dset_id)
+      call h5dwrite_f(dset_id,H5T_NATIVE_INTEGER,ia,dims,error)
+      call h5dclose_f(dset_id,error)
+      end
+c*********************************************************************
+c Attach the real array a(n) to the object loc_id as attribute name.
+      subroutine hdfattrv(loc_id,name,a,n)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: loc_id
+      character*(*) name
+      integer n
+      real a(n)
+      INTEGER(HID_T) :: space_id,attr_id
+      INTEGER(HSIZE_T), DIMENSION(1) :: dims
+      integer error
+
+      dims(1)=n
+      call h5screate_simple_f(1,dims,space_id,error)
+      call h5acreate_f(loc_id,name,H5T_NATIVE_REAL,space_id,attr_id,
+     $     error)
+      call h5awrite_f(attr_id,H5T_NATIVE_REAL,a,dims,error)
+      call h5aclose_f(attr_id,error)
+      call h5sclose_f(space_id,error)
+      end
+c*********************************************************************
+c Attach the real scalar x to the object loc_id as attribute name.
+      subroutine hdfattr(loc_id,name,x)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: loc_id
+      character*(*) name
+      real x
+      INTEGER(HID_T) :: space_id,attr_id
+      INTEGER(HSIZE_T), DIMENSION(1) :: dims
+      integer error
+
+      dims(1)=1
+      call h5screate_f(H5S_SCALAR_F,space_id,error)
+      call h5acreate_f(loc_id,name,H5T_NATIVE_REAL,space_id,attr_id,
+     $     error)
+      call h5awrite_f(attr_id,H5T_NATIVE_REAL,x,dims,error)
+      call h5aclose_f(attr_id,error)
+      call h5sclose_f(space_id,error)
+      end
+c*********************************************************************
+c Integer version of hdfattr.
+      subroutine hdfiattr(loc_id,name,i)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: loc_id
+      character*(*) name
+      integer i
+      INTEGER(HID_T) :: space_id,attr_id
+      INTEGER(HSIZE_T), DIMENSION(1) :: dims
+      integer error
+
+      dims(1)=1
+      call h5screate_f(H5S_SCALAR_F,space_id,error)
+      call h5acreate_f(loc_id,name,H5T_NATIVE_INTEGER,space_id,attr_id,
+     $     error)
+      call h5awrite_f(attr_id,H5T_NATIVE_INTEGER,i,dims,error)
+      call h5aclose_f(attr_id,error)
+      call h5sclose_f(space_id,error)
+      end
+c*********************************************************************
+c Logical version of hdfattr, written as the integer 1 or 0.
+      subroutine hdflattr(loc_id,name,l)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: loc_id
+      character*(*) name
+      logical l
 
+      if(l)then
+         call hdfiattr(loc_id,name,1)
+      else
+         call hdfiattr(loc_id,name,0)
+      endif
+      end
+c*********************************************************************
+c Attach the string s, less trailing blanks, to the object loc_id as
+c attribute name.
+      subroutine hdfsattr(loc_id,name,s)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: loc_id
+      character*(*) name,s
+      INTEGER(HID_T) :: space_id,attr_id,type_id
+      INTEGER(HSIZE_T), DIMENSION(1) :: dims
+      INTEGER(SIZE_T) :: ls
+      integer error
+
+      dims(1)=1
+      ls=len_trim(s)
+      call h5tcopy_f(H5T_NATIVE_CHARACTER,type_id,error)
+      call h5tset_size_f(type_id,ls,error)
+      call h5screate_f(H5S_SCALAR_F,space_id,error)
+      call h5acreate_f(loc_id,name,type_id,space_id,attr_id,error)
+      call h5awrite_f(attr_id,type_id,s(1:ls),dims,error)
+      call h5aclose_f(attr_id,error)
+      call h5sclose_f(space_id,error)
+      call h5tclose_f(type_id,error)
       end
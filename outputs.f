@@ -294,55 +294,271 @@ c Perhaps this extra storage is unnecessary.
       close(9)
       end
 c**********************************************************************
-c Write out the particle data.
-      subroutine partwrt()
+c Checkpoints are unformatted stream files partNNN.dat, one for each
+c process. After the header (ckopen) each holds the random number and
+c velocity diagnostic state of its process, then its particle slots
+c 1 to iocprev: xp, dtprec, vzinit and ipf. The file of process 0
+c continues with the state common to all the processes, written after
+c the step istep: the scalars, phi, the running averages and the step
+c histories up to istep.
+c The file is staged in memory (ckwrite.c) and then written, by a
+c background thread if lasync, so that the run can go on meanwhile.
+c The previous nckkeep checkpoints are kept as partNNN.dat.1 and so on.
+      subroutine partwrt(istep,time,ninjcomp0,lasync)
+      integer istep,ninjcomp0
+      real time
+      logical lasync
 c Common data:
       include 'piccom.f'
+      integer ihead(8),istate(4),iscal(5)
+      real rstate(99),rscal(7)
       character*11 filename
 
       write(filename,'(''part'',i3.3,''.dat'')')myid
-c Delete the file first to help with nfs problems.
-      open(11,file=filename,status='unknown')
-      close(11,status='delete')
-c
-      open(11,file=filename,status='unknown')
-      write(11,*)npartmax,npart,nr,nth,ndim,np
-      write(11,*)xp
-      write(11,*)rhoinf,spotrein,averein
-      write(*,*)'rhoinf,spotrein,averein',rhoinf,spotrein,averein
-      close(11)
+      n=iocprev
+      call ckbegin()
+      call ckputc(ckmagic,8)
+      ihead(1)=ickvers
+      ihead(2)=numprocs
+      ihead(3)=myid
+      ihead(4)=n
+      ihead(5)=nr
+      ihead(6)=nth
+      ihead(7)=npsi
+      ihead(8)=istep
+      call ckputi(ihead,8)
+      call ranstate(.false.,istate,rstate)
+      call ckputi(istate,4)
+      call ckputr(rstate,99)
+      call ckputr(nvdiag,nvmax)
+      call ckputr(vrdiagin,nvmax)
+      call ckputr(vtdiagin,nvmax)
+      call ckputr(xp,ndim*n)
+      call ckputr(dtprec,n)
+      call ckputr(vzinit,n)
+      call ckputi(ipf,n)
+      if(myid.eq.0)then
+         rscal(1)=time
+         rscal(2)=rhoinf
+         rscal(3)=spotrein
+         rscal(4)=averein
+         rscal(5)=adeficit
+         rscal(6)=vprobe
+         rscal(7)=fluxrein
+         iscal(1)=ninjcomp0
+         iscal(2)=nstepsave
+         iscal(3)=nrein
+         iscal(4)=nreintry
+         iscal(5)=ninner
+         call ckputr(rscal,7)
+         call ckputi(iscal,5)
+         call ckputr(phi,size(phi))
+         call ckputr(phiaxis,size(phiaxis))
+         call ckputr(diagrho,size(diagrho))
+         call ckputr(diagphi,size(diagphi))
+         call ckputr(diagchi,size(diagchi))
+         call ckputr(fincellave,size(fincellave))
+         call ckputr(vrincellave,size(vrincellave))
+         call ckputr(vr2incellave,size(vr2incellave))
+         call ckputr(rhoDiag,size(rhoDiag))
+         call ckputr(pDiag,size(pDiag))
+         call ckputr(vrDiag,size(vrDiag))
+         call ckputr(vtDiag,size(vtDiag))
+         call ckputr(vpDiag,size(vpDiag))
+         call ckputr(vr2Diag,size(vr2Diag))
+         call ckputr(vt2Diag,size(vt2Diag))
+         call ckputr(vp2Diag,size(vp2Diag))
+         call ckputr(vrtDiag,size(vrtDiag))
+         call ckputr(vrpDiag,size(vrpDiag))
+         call ckputr(vtpDiag,size(vtpDiag))
+         call ckputr(fluxprobe,istep)
+         call ckputr(enertot,istep)
+         call ckputr(zmom(1:istep,:,:),size(zmom(1:istep,:,:)))
+         call ckputr(xmom(1:istep,:,:),size(xmom(1:istep,:,:)))
+         call ckputr(ymom(1:istep,:,:),size(ymom(1:istep,:,:)))
+         call ckputr(nincellstep,size(nincellstep(:,:,0:istep)))
+         call ckputr(vrincellstep,size(vrincellstep(:,:,0:istep)))
+         call ckputr(vr2incellstep,size(vr2incellstep(:,:,0:istep)))
+         write(*,*)'Checkpoint at step',istep,
+     $        ' rhoinf,spotrein,averein',rhoinf,spotrein,averein
+      endif
+      call ckcommit(filename,nckkeep,lasync)
       end
 
 c**********************************************************************
-c Read in the particle data.
-      subroutine partrd(success)
+c Restart from the checkpoint files partNNN.dat: set the particles and
+c the state at the end of step istep. With the number of processes of
+c the checkpoint each process takes back its own slots and random
+c numbers. Otherwise the slots of all the files are shared evenly, in
+c order, among the processes, and the random numbers and velocity
+c diagnostics start afresh.
+      subroutine partrd(success,istep,time,ninjcomp0)
       logical success
+      integer istep,ninjcomp0
+      real time
 c Common data:
       include 'piccom.f'
-      character*11 filename
+      integer istate(4)
+      real rstate(99)
+      logical lok
+      integer*8 ipos,ipos0,iposc,ntot,ioff,i1,i2
+      integer, allocatable :: nslot(:)
 
-      write(filename,'(''part'',i3.3,''.dat'')')myid
       success=.false.
-      open(11,file=filename,status='old',err=101)
-      read(11,*,err=100,end=100)ipartmax,ipart,ir,ith,idim,ip
-      if(ipartmax.eq.npartmax .and. ipart.eq.npart
-     $     )then
-c     $ .and. ir.eq.nr .and. ith.eq.nth )then
-         write(*,*)'Using saved particle data.'
-         read(11,*,err=100,end=100)xp
-         read(11,*,err=100,end=100)rhoinf,spotrein,averein
-      write(*,*)'rhoinf,spotrein,averein',rhoinf,spotrein,averein
-         success=.true.
+      call ckopen(11,0,nprocs,n0,is0,ipos0,lok)
+      if(.not.lok)return
+      close(11)
+      if(is0.ge.maxsteps)then
+         write(*,*)'Checkpoint is at step',is0,'  of',maxsteps
+         return
+      endif
+c Lengths of a real, an integer, the per-process block and a slot.
+      inquire(iolength=lr)time
+      inquire(iolength=li)is0
+      lrk=4*li+(99+3*nvmax)*lr
+      lslot=(ndim+2)*lr+li
+c The common state, read last, follows the slots of process 0.
+      iposc=ipos0+lrk+int(n0,8)*lslot
+
+      if(nprocs.eq.numprocs)then
+c Same processes: this one's own file, slot for slot.
+         call ckopen(11,myid,np1,n,is1,ipos0,lok)
+         if(.not.lok)return
+         if(is1.ne.is0)goto 101
+         if(n.gt.npartmax)goto 102
+         read(11,pos=ipos0,err=100,end=100)istate,rstate
+     $        ,nvdiag,vrdiagin,vtdiagin
+         read(11,err=100,end=100)xp(:,1:n),dtprec(1:n),vzinit(1:n)
+     $        ,ipf(1:n)
+         close(11)
+         call ranstate(.true.,istate,rstate)
       else
-         write(*,*)'Particle data mismatch',ipartmax,npartmax,ipart,
-     $        npart,ir,nr,ith,nth
+c Take slots i1+1 to i2 of the slots of all the files in order.
+         allocate(nslot(0:nprocs-1))
+         ntot=0
+         do id=0,nprocs-1
+            call ckopen(11,id,np1,nslot(id),is1,ipos0,lok)
+            if(.not.lok)return
+            close(11)
+            if(is1.ne.is0)goto 101
+            ntot=ntot+nslot(id)
+         enddo
+         i1=(ntot*myid)/numprocs
+         i2=(ntot*(myid+1))/numprocs
+         if(i2-i1.gt.npartmax)goto 102
+         n=0
+         ioff=0
+         do id=0,nprocs-1
+            j1=int(max(i1,ioff)-ioff)
+            j2=int(min(i2,ioff+nslot(id))-ioff)
+            if(j2.gt.j1)then
+               call ckopen(11,id,np1,ns,is1,ipos0,lok)
+               if(.not.lok)return
+               m=j2-j1
+               ipos=ipos0+lrk
+               read(11,pos=ipos+int(j1,8)*ndim*lr,err=100,end=100)
+     $              xp(:,n+1:n+m)
+               ipos=ipos+int(ns,8)*ndim*lr
+               read(11,pos=ipos+int(j1,8)*lr,err=100,end=100)
+     $              dtprec(n+1:n+m)
+               ipos=ipos+int(ns,8)*lr
+               read(11,pos=ipos+int(j1,8)*lr,err=100,end=100)
+     $              vzinit(n+1:n+m)
+               ipos=ipos+int(ns,8)*lr
+               read(11,pos=ipos+int(j1,8)*li,err=100,end=100)
+     $              ipf(n+1:n+m)
+               close(11)
+               n=n+m
+            endif
+            ioff=ioff+nslot(id)
+         enddo
+c Drop the empty slots.
+         m=0
+         do i=1,n
+            if(ipf(i).gt.0)then
+               m=m+1
+               xp(:,m)=xp(:,i)
+               dtprec(m)=dtprec(i)
+               vzinit(m)=vzinit(i)
+               ipf(m)=ipf(i)
+            endif
+         enddo
+         n=m
+         if(lfixedn .and. n.ne.npart)then
+            write(*,*)'Process',myid,' has',n,' particles, not',npart
+            npart=n
+         endif
       endif
+      do i=n+1,npartmax
+         ipf(i)=0
+      enddo
+      iocprev=n
+
+      open(11,file='part000.dat',status='old',access='stream',
+     $     form='unformatted',err=100)
+      read(11,pos=iposc,err=100,end=100)time,rhoinf,spotrein,averein
+     $     ,adeficit,vprobe,fluxrein,ninjc,nstepsave,nrein,nreintry
+     $     ,ninner
+      read(11,err=100,end=100)phi,phiaxis,diagrho,diagphi,diagchi
+     $     ,fincellave,vrincellave,vr2incellave
+      read(11,err=100,end=100)rhoDiag,pDiag,vrDiag,vtDiag,vpDiag
+     $     ,vr2Diag,vt2Diag,vp2Diag,vrtDiag,vrpDiag,vtpDiag
+      read(11,err=100,end=100)fluxprobe(1:is0),enertot(1:is0)
+     $     ,zmom(1:is0,:,:),xmom(1:is0,:,:),ymom(1:is0,:,:)
+     $     ,nincellstep(:,:,0:is0),vrincellstep(:,:,0:is0)
+     $     ,vr2incellstep(:,:,0:is0)
       close(11)
+c The injections per step were those of the checkpoint's processes.
+      if(.not.lfixedn)ninjcomp0=int((int(ninjc,8)*nprocs)/numprocs)
+      istep=is0
+      if(myid.eq.0)write(*,*)'Restart at step',istep,
+     $     ' rhoinf,spotrein,averein',rhoinf,spotrein,averein
+      success=.true.
       return
  100  close(11)
-      write(*,*) 'Error reading pardata.dat'
+      write(*,*)'Error reading checkpoint'
+      return
+ 101  close(11)
+      write(*,*)'Checkpoint files are of different steps'
+      return
+ 102  close(11)
+      write(*,*)'Too many particles for npartmax',npartmax
+      end
+c**********************************************************************
+c Open the checkpoint file of process id on unit iu and read its
+c header: the number of processes nprocs that wrote the checkpoint,
+c the number of slots nslot in the file and the step istep. ipos is the
+c position of what follows the header. lok is false, and the file is
+c closed, unless it is a checkpoint of this version for this mesh.
+      subroutine ckopen(iu,id,nprocs,nslot,istep,ipos,lok)
+      integer iu,id,nprocs,nslot,istep
+      integer*8 ipos
+      logical lok
+      include 'piccom.f'
+      character*8 cmagic
+      character*11 filename
+
+      lok=.false.
+      write(filename,'(''part'',i3.3,''.dat'')')id
+      open(iu,file=filename,status='old',access='stream',
+     $     form='unformatted',err=101)
+      read(iu,err=100,end=100)cmagic,ivers,nprocs,idf,nslot,ir,ith,ip
+     $     ,istep
+      if(cmagic.ne.ckmagic .or. ivers.ne.ickvers)then
+         write(*,*)filename,' is not a checkpoint of version',ickvers
+      elseif(ir.ne.nr .or. ith.ne.nth .or. ip.ne.npsi)then
+         write(*,*)'Checkpoint mesh mismatch',ir,nr,ith,nth,ip,npsi
+      else
+         inquire(iu,pos=ipos)
+         lok=.true.
+         return
+      endif
+      close(iu)
+      return
+ 100  close(iu)
+      write(*,*)'Error reading ',filename
       return
- 101  write(*,*) 'No particle file to read.'
+ 101  write(*,*)'No checkpoint file ',filename
       end
 c**********************************************************************
 c Get the average and slope over the rmesh range i1,i2.
@@ -2,7 +2,7 @@
       integer npartmax,npart,nr,nth,npsi,ndim,np
 c Number of particles: npartmax, radial and theta mesh size: nr, nth.
 c Don't change anything else.
-      parameter (npartmax=400000,np=1,ndim=6)
+      parameter (np=1,ndim=6)
 c Use of particle advance subcycling in inner regions for accuracy.
       logical lsubcycle
 c Integrator type. True=old, False=new symplectic schemes
@@ -11,27 +11,31 @@ c CIC definitions
       logical LCIC,collcic
       integer NRUSED,NTHUSED,NPSIUSED,NRFULL,NTHFULL,NPSIFULL
       parameter (LCIC=.true.)
-      integer nrsize,nthsize,npsisize
-c These correspond to nrfull, nthfull.and npsifull
-      parameter (nrsize=306,nthsize=31,npsisize=31)
+      integer nrsize,nthsize,npsisize,nstepmax
+c These correspond to nrfull, nthfull.and npsifull. They, the number
+c of particle slots npartmax and of steps nstepmax are set from the
+c command line. The arrays they dimension are allocated by picalloc,
+c with the shapes given in the comments.
 c Positions and velocities of particles (6-d phase-space).
-      real xp(ndim,npartmax)
-      real vzinit(npartmax)
-
-      real dtprec(npartmax)
-c Flag of particle slot status (e.g. in use or not)
-      integer ipf(npartmax)
-c The potential normalized to Te/e
-      real phi(0:nrsize,0:nthsize,0:npsisize)
+c xp(ndim,npartmax), vzinit(npartmax), dtprec(npartmax)
+      real, pointer, contiguous :: xp(:,:),vzinit(:),dtprec(:)
+c Flag of particle slot status (e.g. in use or not). ipf(npartmax)
+      integer, pointer, contiguous :: ipf(:)
+c The potential normalized to Te/e. phi(0:nrsize,0:nthsize,0:npsisize)
+      real, pointer, contiguous :: phi(:,:,:)
 c The potential on axis (cos(theta)=+-1) before averaging
-      real phiaxis(0:nrsize,2,0:npsisize)
-c Charge density
-      real rho(0:nrsize,0:nthsize,0:npsisize)
-      real rhoDiag(0:nrsize,0:nthsize,0:npsisize)
+c phiaxis(0:nrsize,2,0:npsisize)
+      real, pointer, contiguous :: phiaxis(:,:,:)
+c Charge density. Same shape as phi.
+      real, pointer, contiguous :: rho(:,:,:),rhoDiag(:,:,:)
 c Injection complement. How many particles to reinject each step
       integer ninjcomp
 c Highest occupied particle slot.
       integer iocprev
+c Steps between sorts of the particles by cell (0: never sort)
+      integer nsort
+c Deposit the charge for the next step inside the particle advance
+      logical lfused
 
       real pi
       parameter (pi=3.1415927)
@@ -40,86 +44,115 @@ c Highest occupied particle slot.
       logical lfixedn
       integer myid,numprocs
       real rmtoz
-      common /piccom/xp,npart,vzinit,dtprec,phi,rho,rhoDiag,cerr,bdyfc
+      common /piccom/xp,vzinit,dtprec,ipf,phi,phiaxis,rho,rhoDiag
+     $     ,npart,cerr,bdyfc
      $     ,Ti,vd,cd,cB,diags,ninjcomp,lplot,ldist,linsulate,lfloat
-     $     ,lat0,lap0 ,localinj,lfixedn,myid,numprocs,rmtoz,ipf,iocprev
-     $     ,Bz,lsubcycle,verlet,collcic,phiaxis
+     $     ,lat0,lap0 ,localinj,lfixedn,myid,numprocs,rmtoz,iocprev
+     $     ,Bz,lsubcycle,verlet,collcic,nblk,nsort,lfused
+     $     ,npartmax,nrsize,nthsize,npsisize,nstepmax
+
+c *******************************************************************
+c Blocked particle advance. Active particles of a block of nblk slots
+c are copied into these structure-of-arrays buffers so that the kick,
+c rotation and drift are unit-stride loops. nblk=0 means no blocking.
+c Each thread of the particle advance has its own buffers.
+      integer nblkmax
+      parameter (nblkmax=64)
+      integer nblk,npb
+c Slot numbers of the active particles held in the block
+      integer ipb(nblkmax)
+      real xpb(nblkmax),ypb(nblkmax),zpb(nblkmax)
+      real vxpb(nblkmax),vypb(nblkmax),vzpb(nblkmax)
+c Accelerations and the acceleration time (dtnow) of each particle
+      real axpb(nblkmax),aypb(nblkmax),azpb(nblkmax),dtpb(nblkmax)
+      common /partblk/npb,ipb,xpb,ypb,zpb,vxpb,vypb,vzpb,axpb,aypb
+     $     ,azpb,dtpb
+c$omp threadprivate(/partblk/)
 
 
 c *******************************************************************
 c Momenta of the distribution function
 
+c All of shape (1:nrsize-1,1:nthsize-1,1:npsisize-1).
 c The particle number
-      real psum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: psum(:,:,:)
 c The sum of particle radial velocities
-      real vrsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vrsum(:,:,:)
 c Sum of theta velocities
-      real vtsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vtsum(:,:,:)
 c Sum of phi velocities
-      real vpsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vpsum(:,:,:)
 c The sum of particle velocities squared
-      real vr2sum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vt2sum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vp2sum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vr2sum(:,:,:),vt2sum(:,:,:)
+      real, pointer, contiguous :: vp2sum(:,:,:)
 c Off diagonal terms
-      real vrtsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vrpsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vtpsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vrtsum(:,:,:),vrpsum(:,:,:)
+      real, pointer, contiguous :: vtpsum(:,:,:)
 
 c The sum of particle xyz-velocities
-      real vxsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vysum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vzsum(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: vxsum(:,:,:),vysum(:,:,:)
+      real, pointer, contiguous :: vzsum(:,:,:)
 
 c Diagnostic sums
-      real pDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vrDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vtDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vpDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vr2Diag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vt2Diag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vp2Diag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vrtDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vrpDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
-      real vtpDiag(1:nrsize-1,1:nthsize-1,1:npsisize-1)
+      real, pointer, contiguous :: pDiag(:,:,:),vrDiag(:,:,:)
+      real, pointer, contiguous :: vtDiag(:,:,:),vpDiag(:,:,:)
+      real, pointer, contiguous :: vr2Diag(:,:,:),vt2Diag(:,:,:)
+      real, pointer, contiguous :: vp2Diag(:,:,:),vrtDiag(:,:,:)
+      real, pointer, contiguous :: vrpDiag(:,:,:),vtpDiag(:,:,:)
 
 c     Total sum of particle xyz-velocities, i.e. total current curr(4)
 c     is the particle sum
       real curr(4)
 
       common /momcom/psum,vrsum,vtsum,vpsum,vr2sum,vt2sum,vp2sum ,vrtsum
-     $     ,vrpsum,vtpsum,vzsum,vxsum,vysum,curr,pDiag,vrDiag,vtDiag
+     $     ,vrpsum,vtpsum,vzsum,vxsum,vysum,pDiag,vrDiag,vtDiag
      $     ,vpDiag,vr2Diag,vt2Diag,vp2Diag ,vrtDiag,vrpDiag,vtpDiag
 c*********************************************************************
-c Radius mesh
-      real r(0:nrsize),rcc(0:nrsize)
-c Theta angle mesh
-      real th(0:nthsize),tcc(0:nthsize)
-c Theta mesh radians
-      real thang(0:nthsize)
-c Poloidal (Psi) Mesh. Only cell center are useful
-      real pcc(0:npsisize)
-c Inverse of volume of radial shells.
-      real volinv(0:nrsize)
-c Precalculation functions
+c Radius mesh. r(0:nrsize),rcc(0:nrsize)
+      real, pointer, contiguous :: r(:),rcc(:)
+c Theta angle mesh. th(0:nthsize),tcc(0:nthsize)
+      real, pointer, contiguous :: th(:),tcc(:)
+c Theta mesh radians. thang(0:nthsize)
+      real, pointer, contiguous :: thang(:)
+c Poloidal (Psi) Mesh. Only cell center are useful. pcc(0:npsisize)
+      real, pointer, contiguous :: pcc(:)
+c Inverse of volume of radial shells. volinv(0:nrsize)
+      real, pointer, contiguous :: volinv(:)
+c Precalculation functions, of lengths 4*nrsize, 4*nthsize, 4*npsisize
       integer nrpre,ntpre,nppre
-      parameter (nrpre=4*nrsize,ntpre=4*nthsize,nppre=4*npsisize)
-      integer irpre(nrpre),itpre(ntpre),ippre(nppre)
+      integer, pointer, contiguous :: irpre(:),itpre(:),ippre(:)
       real rfac,tfac,pfac
-c Non-uniform handling quantities.
-      real hr(0:nrsize+1),zeta(0:nrsize+1),zetahalf(0:nrsize+1),
-     $     cminus(nrsize),cmid(nrsize),cplus(nrsize)
+c Non-uniform handling quantities. hr, zeta and zetahalf(0:nrsize+1),
+c cminus, cmid and cplus(nrsize)
+      real, pointer, contiguous :: hr(:),zeta(:),zetahalf(:)
+      real, pointer, contiguous :: cminus(:),cmid(:),cplus(:)
 c Lower limit of averaging range. 0.6 by default
       real avelim
 c Parallel or serial solving
       logical cgparallel
 c Parallel bloc solver arguments
       integer idim1,idim2,idim3
+c Number of processes requested for the parallel solver (0: all)
+      integer ncgproc
+c Choose between the serial and parallel solvers by timing them
+      logical ltune
 
-      common /meshcom/r,rcc,th,tcc,thang,volinv,irpre,itpre,rfac,tfac,
-     $     pcc,ippre,pfac, hr,zeta,zetahalf,cminus,cmid,cplus ,avelim
+      common /meshcom/r,rcc,th,tcc,thang,volinv,irpre,itpre,
+     $     pcc,ippre, hr,zeta,zetahalf,cminus,cmid,cplus
+     $     ,rfac,tfac,pfac,avelim,nrpre,ntpre,nppre
      $     ,nr,NRFULL,NRUSED,NPSIFULL,NPSIUSED,nth,npsi,NTHFULL,NTHUSED
-     $     ,cgparallel,idim1,idim2,idim3
+     $     ,cgparallel,idim1,idim2,idim3,ncgproc,ltune
+c*********************************************************************
+c Field cache used by getaccel, filled by efieldcache after each solve.
+c Gradients of phi: radial at the half radial points k+1/2 (index k),
+c theta and psi on meshes refined by two (node j at 2j, j+1/2 at 2j+1).
+c Radial index nr+1 holds the extrapolation used beyond the outer edge.
+c ercache(0:nrsize,nthsize,npsisize), etcache(nrsize,2:2*nthsize,
+c npsisize), epcache(nrsize,nthsize,2:2*npsisize+2)
+      real, pointer, contiguous :: ercache(:,:,:),etcache(:,:,:)
+      real, pointer, contiguous :: epcache(:,:,:)
+      logical lecache
+      common /ecache/ercache,etcache,epcache,lecache
 c********************************************************************
 c Random interpolate data.
       integer nvel,nQth
@@ -138,18 +171,18 @@ c from 0 to 9)
       common /rancom/Gcom,Vcom,Qcom,pu1,pu2,Pc,infdbl,bcphi,bcr
 c********************************************************************
 c diagnostic data
-      integer nvmax,nrein,nreintry,ninner,nstepmax
-      parameter (nvmax=60,nstepmax=10001)
+      integer nvmax,nrein,nreintry,ninner
+      parameter (nvmax=60)
       real nvdiag(nvmax),nvdiagave(nvmax),vdiag(nvmax)
       real vrdiagin(nvmax),vtdiagin(nvmax)
       real vrange
-      real diagrho(nrsize),diagphi(nrsize)
-      real diagchi(0:nthsize)
+c diagrho(nrsize),diagphi(nrsize), diagchi(0:nthsize)
+      real, pointer, contiguous :: diagrho(:),diagphi(:),diagchi(:)
       real phiout
       integer partz,fieldz,epressz,enccharge,lorentz
       parameter(enccharge=1,fieldz=2,epressz=3,partz=4,lorentz=5)
-c Total particle flux to probe
-      real fluxprobe(nstepmax)
+c Total particle flux to probe. fluxprobe(nstepmax)
+      real, pointer, contiguous :: fluxprobe(:)
 c Total momentum flux to probe
       real zmomprobe,xmomprobe,ymomprobe
 c Total energy collected
@@ -158,24 +191,26 @@ c Z-momentum flux across outer boundary.
       real zmout,xmout,ymout
 c Combined zmom data: fields, electron pressure, ion momentum.
 c For inner 1, outer 2. zmom also carries the probe charge
-      real zmom(nstepmax,5,2),xmom(nstepmax,2:5,2),ymom(nstepmax,2:5,2)
-c enertot is the reduced enerprobe for each time-step
-      real enertot(nstepmax)
+c zmom(nstepmax,5,2),xmom(nstepmax,2:5,2),ymom(nstepmax,2:5,2)
+      real, pointer, contiguous :: zmom(:,:,:),xmom(:,:,:),ymom(:,:,:)
+c enertot is the reduced enerprobe for each time-step. (nstepmax)
+      real, pointer, contiguous :: enertot(:)
 c Number of particles striking probe in theta/psi cell
-      real nincellstep(nthsize,npsisize,0:nstepmax)
-      real vrincellstep(nthsize,npsisize,0:nstepmax)
-      real vr2incellstep(nthsize,npsisize,0:nstepmax)
-      real nincell(nthsize,npsisize)
-      real vrincell(nthsize,npsisize)
-      real vr2incell(nthsize,npsisize)
+c (nthsize,npsisize,0:nstepmax)
+      real, pointer, contiguous :: nincellstep(:,:,:)
+      real, pointer, contiguous :: vrincellstep(:,:,:)
+      real, pointer, contiguous :: vr2incellstep(:,:,:)
+c (nthsize,npsisize)
+      real, pointer, contiguous :: nincell(:,:),vrincell(:,:)
+      real, pointer, contiguous :: vr2incell(:,:)
 c Impose the bohm condition or not
       logical bohm
-c Ave flux
-      real fincellave(nthsize,npsisize)
+c Ave flux. (nthsize,npsisize)
+      real, pointer, contiguous :: fincellave(:,:)
 c Ave radial mom flux
-      real vrincellave(nthsize,npsisize)
+      real, pointer, contiguous :: vrincellave(:,:)
 c Ave radial vr2 flux
-      real vr2incellave(nthsize,npsisize)
+      real, pointer, contiguous :: vr2incellave(:,:)
 c Number of particles reinjected per theta cell.
 c      integer noutrein(nth),ivoutrein(nth)
 c Sum and average of potentials at which particles were reinjected.
@@ -190,26 +225,94 @@ c Coefficient of density deficit, for external solution
       real adeficit
 c Cell in which to accumulate distribution functions
       integer ircell,itcell
-      common /diagcom/nvdiag,nvdiagave,vdiag,vrange,diagrho,diagphi,
-     $     diagchi,phiout,nrein,nreintry,ninner,fluxprobe,nincellstep
-     $     ,vrincellstep,vr2incellstep,nincell,vrincell,vr2incell,rhoinf
-     $     ,vrdiagin,vtdiagin, spotrein,averein ,fluxrein ,ntrapre
-     $     ,adeficit, ircell,itcell ,zmout,xmout,ymout ,zmomprobe
-     $     ,ymomprobe,xmomprobe,fincellave ,vrincellave,vr2incellave
-     $     ,zmom,xmom,ymom ,enerprobe ,enertot, bohm
+      common /diagcom/diagrho,diagphi,diagchi,fluxprobe,nincellstep
+     $     ,vrincellstep,vr2incellstep
+     $     ,fincellave ,vrincellave,vr2incellave
+     $     ,zmom,xmom,ymom ,enertot
+     $     ,nvdiagave,vdiag,vrange,phiout,rhoinf
+     $     ,averein
+     $     ,adeficit, ircell,itcell, bohm
+c Sums accumulated by the particle advance. Each thread of a threaded
+c padvnc has its own copy; they are merged into the master's copy,
+c which is the one seen by the rest of the code, at the end of padvnc.
+c The other threads allocate their nincell, vrincell and vr2incell.
+      common /padvacc/nincell,vrincell,vr2incell
+     $     ,nrein,nreintry,ninner,ntrapre,spotrein,fluxrein
+     $     ,zmomprobe,xmomprobe,ymomprobe,enerprobe,zmout,xmout,ymout
+     $     ,curr,nvdiag,vrdiagin,vtdiagin
+c$omp threadprivate(/padvacc/)
+c Buffers of the non-blocking reductions of the moments (sumstart) and
+c of the particle advance data (partreduce), their lengths, requests
+c and which optional parts were packed.
+c Lengths nsumbuf=13*(nrsize-1)*(nthsize-1)*(npsisize-1)+4 and
+c nprtbuf=9+3*nthsize*npsisize+3*nvmax.
+      integer nsumbuf,nprtbuf
+      real, pointer, contiguous :: sumbuf(:),sumbuftot(:)
+      real, pointer, contiguous :: prtbuf(:),prtbuftot(:)
+      integer, pointer, contiguous :: isumreq(:)
+      integer icntbuf(3),icnttot(3),nsumb,iprtreq(2)
+      integer nsumrq
+      logical lsumv(3),lprtv(2),lsumsl
+c psi slabs. Process p<nsl owns the psi cells kpsl(p)+1 to kpsl(p+1)
+c of the moments, rho and the *Diag arrays, which it reduces and
+c processes in rhocalc and the diagnostics; kpsi1 to kpsi2 are those of
+c this process (none if kpsi2<kpsi1). Slab p is packed in sumbuf after
+c position isumoff(p), slab 0 with curr in front. p is the rank in
+c isl_comm, which is MPI_COMM_WORLD, or with lshm the communicator of
+c the node leaders (myslid<0 elsewhere).
+c kpsl and isumoff are (0:npsisize), isumreq and kslown (npsisize).
+      integer, pointer, contiguous :: kpsl(:),isumoff(:)
+      integer nsl,kpsi1,kpsi2
+      integer isl_comm,myslid
+c Node level sharing: the processes of a node (node_comm, rank mynode)
+c sum their moments onto the node leader (mynode=0) before the
+c reduction over the nodes, and receive phi through a shared segment.
+c With lshmphi phi and phiaxis point into that segment, and this
+c process only reads them.
+      logical lshm,lshmphi
+      integer node_comm,mynode
+c Domain decomposition: each process keeps only the particles in its
+c psi slab, kslown(k) being the owner of psi cell k, and their deposit
+c beyond the slab goes to the next slab instead of a global reduction.
+c The fields are not decomposed: phi is solved and broadcast whole.
+      logical ldd
+      integer, pointer, contiguous :: kslown(:)
+      common /redcom/sumbuf,sumbuftot,prtbuf,prtbuftot,isumreq,kpsl
+     $     ,isumoff,kslown,nsumbuf,nprtbuf,icntbuf,icnttot
+     $     ,nsumb,iprtreq,lsumv,lprtv,nsumrq,lsumsl,nsl
+     $     ,kpsi1,kpsi2,isl_comm,myslid,lshm,node_comm,mynode
+     $     ,ldd,lshmphi
 c*********************************************************************
 c Poisson coefficients for iterative solution, etc.
 
       real debyelen,vprobe,Ezext
-      real apc(0:nrsize),bpc(0:nrsize)
-      real cpc(0:nrsize,0:nthsize),dpc(0:nrsize,0:nthsize)
-      real epc(0:nrsize,0:nthsize)
-      real fpc(0:nrsize,0:nthsize)
-      real gpc(0:nthsize,0:npsisize,1:5)
+c apc, bpc(0:nrsize), cpc, dpc, epc, fpc(0:nrsize,0:nthsize),
+c gpc(0:nthsize,0:npsisize,1:5)
+      real, pointer, contiguous :: apc(:),bpc(:)
+      real, pointer, contiguous :: cpc(:,:),dpc(:,:),epc(:,:),fpc(:,:)
+      real, pointer, contiguous :: gpc(:,:,:)
 c     Flag indicating to use biconjugate gradient method (not min. res.)
       logical lbcg
-      common /poisson/debyelen,vprobe,Ezext,apc,bpc,cpc,dpc,fpc,epc,gpc
-     $  ,lbcg
+c     Flag to precondition cg3D with a multigrid V-cycle (multigrid.f)
+      logical lmgprec
+c     Flag to precondition cg3D by a psi-Fourier direct solve (psifft.f)
+      logical lpsifft
+c     Maximum number of Newton iterations per field solve
+      integer nnewton
+c     Flag to use the pipelined BiCG of cg3dmpi (one reduction/iteration)
+      logical lpipecg
+c     Iterations of the last field solve, over its Newton iterations
+      integer itsolve
+c     Flag to not print the iterations of each solve (solver tuning)
+      logical lsolvequiet
+      common /poisson/apc,bpc,cpc,dpc,fpc,epc,gpc,debyelen,vprobe,Ezext
+     $  ,lbcg,lmgprec,nnewton,lpsifft,lpipecg,itsolve,lsolvequiet
+c     Diagonal fpc+exp(phi) of the matrix of the serial solver, set at
+c     the start of each solve (cg3D) since phi does not change during it.
+c     Stored compactly as (n1+1,0:n2+1,0:n3) for the mesh being solved,
+c     in nrsize*(nthsize+2)*(npsisize+1) values.
+      real, pointer, contiguous :: adiag(:)
+      common /poissondiag/adiag
 c*********************************************************************
 c Smoothing steps
       integer nstepsave,nsamax,diagsamp
@@ -219,16 +322,26 @@ c*********************************************************************
 c Orbit plotting storage for tracking the first norbits orbits.
       integer nobsmax,norbits
       parameter (nobsmax=100)
-      real xorbit(nstepmax,nobsmax),yorbit(nstepmax,nobsmax),
-     $     zorbit(nstepmax,nobsmax)
-      real vxorbit(nstepmax,nobsmax),vyorbit(nstepmax,nobsmax),
-     $     vzorbit(nstepmax,nobsmax),rorbit(nstepmax,nobsmax)
+c All (nstepmax,nobsmax)
+      real, pointer, contiguous :: xorbit(:,:),yorbit(:,:),zorbit(:,:)
+      real, pointer, contiguous :: vxorbit(:,:),vyorbit(:,:)
+      real, pointer, contiguous :: vzorbit(:,:),rorbit(:,:)
       integer iorbitlen(nobsmax)
-      common /orbits/norbits,iorbitlen,xorbit,yorbit,zorbit,rorbit,
-     $     vxorbit,vyorbit,vzorbit
+      common /orbits/xorbit,yorbit,zorbit,rorbit,
+     $     vxorbit,vyorbit,vzorbit,norbits,iorbitlen
 
 c*********************************************************************
 c Data necessary for the orbit tracking
       logical orbinit
       integer maxsteps,trackinit
       common /orbtrack/orbinit,maxsteps,trackinit
+c*********************************************************************
+c Identification and format version of the checkpoint files partNNN.dat
+c written by partwrt and read by partrd.
+      character*8 ckmagic
+      integer ickvers
+      parameter (ckmagic='SCEPCKPT',ickvers=1)
+c Number of older checkpoints kept, as partNNN.dat.1 and so on, when a
+c new one is written.
+      integer nckkeep
+      common /ckcom/nckkeep
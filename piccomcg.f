@@ -27,7 +27,10 @@ c     structure of icoords (1,(idims(1)+1),(idims(1)+1)*(idims(2)+1),...)
       integer iLcoords(ndims+1)
 
 c     origin of the blocks (in the total i,j frame), in a linear referencing
-      parameter (norigmax=1000)
+c     It has (idims(1)+1)*(idims(2)+1)*(idims(3)+1) elements. Blocks
+c     have at least 2 cells each way, so (nrsize/2+1)*(nthsize/2+1)
+c     *(npsisize/2+1) of piccom.f is always enough.
+      parameter (norigmax=40000)
       integer iorig(norigmax)
 
 c     dimension of my block (in the total i,j frame)
@@ -0,0 +1,24 @@
+c*********************************************************************
+c Storage of the psi-Fourier preconditioner, see psifft.f. Include
+c after piccom.f.
+c npsimode=npsisize/2, nbandmax=nrsize*nthsize, nhalfmax=nbandmax/2+1.
+c The arrays are allocated at the first psisetup.
+      integer npsimode,nbandmax,nhalfmax
+c Highest mode, band half-width (n2) and size of each (r,theta) system
+      integer nmode,nband,nequ
+c Banded LU factors of the (r,theta) matrix of each psi mode
+c psab(-nthsize:nthsize,nbandmax,0:npsimode)
+      real, pointer, contiguous :: psab(:,:,:)
+c Roots of unity cos and sin(2 pi k/npsi), (0:npsisize), and the
+c prime factors of npsi, in increasing order, used by psfft.
+      real, pointer, contiguous :: psct(:),psst(:)
+      integer nfac,ifac(32)
+c Complex FFT work space, two (r,theta) columns packed into each
+c transform. (nhalfmax,0:npsisize)
+      real, pointer, contiguous :: psxr(:,:),psxi(:,:)
+      real, pointer, contiguous :: psyr(:,:),psyi(:,:)
+c Cosine and sine transforms of the right hand side, mode by mode
+c (nbandmax,0:npsimode)
+      real, pointer, contiguous :: pswc(:,:),psws(:,:)
+      common /psicom/psab,psct,psst,pswc,psws,psxr,psxi,psyr,psyi
+     $     ,nmode,nband,nequ,npsimode,nbandmax,nhalfmax,nfac,ifac
@@ -0,0 +1,333 @@
+c******************************************************************
+c Fourier-in-psi preconditioner for the serial Poisson solver cg3D.
+c
+c The stencil couples psi cells only through epc(i,j), which does not
+c depend on psi. Replacing exp(phi) and the outer boundary coefficients
+c gpc by their psi averages therefore gives a matrix that is diagonal
+c in the psi Fourier modes: mode m sees the (r,theta) 5-point matrix
+c with 2*epc*cos(2 pi m/npsi) added to the diagonal. Each of those is
+c factored once per solve with a banded LU, the band being the theta
+c direction. Applying the preconditioner is a transform in psi, one
+c banded solve per mode, and the inverse transform. When phi does not
+c depend on psi it is the exact inverse of A.
+c
+c The psi transform is a mixed-radix FFT (psfft) applied to two real
+c (r,theta) columns at once. It costs about npsi*(p1+p2+...) per
+c column for npsi=p1*p2*..., so npsi should have small prime factors:
+c a large prime npsi falls back to a direct transform, O(npsi**2).
+c******************************************************************
+      subroutine psisetup(n1,n2,n3,dg)
+
+c Factor the mode matrices for the current matrix of atimes, whose
+c diagonal is dg.
+
+      include 'piccom.f'
+      include 'psicom.f'
+      integer n1,n2,n3
+      real dg(n1+1,0:n2+1,0:*)
+      real dbar(nrsize,nthsize),gbar(nthsize,5)
+
+      if(.not.associated(psab))then
+         npsimode=npsisize/2
+         nbandmax=nrsize*nthsize
+         allocate(psab(-nthsize:nthsize,nbandmax,0:npsimode))
+         allocate(pswc(nbandmax,0:npsimode),psws(nbandmax,0:npsimode))
+         nhalfmax=nbandmax/2+1
+         allocate(psct(0:npsisize),psst(0:npsisize))
+         allocate(psxr(nhalfmax,0:npsisize),psxi(nhalfmax,0:npsisize))
+         allocate(psyr(nhalfmax,0:npsisize),psyi(nhalfmax,0:npsisize))
+      endif
+      nmode=n3/2
+      nband=n2
+      nequ=(n1-1)*n2
+      do k=0,n3-1
+         psct(k)=cos(2.*pi*k/n3)
+         psst(k)=sin(2.*pi*k/n3)
+      enddo
+c Prime factors of n3
+      nfac=0
+      n=n3
+      ip=2
+ 1    if(n.gt.1)then
+         if(mod(n,ip).eq.0)then
+            nfac=nfac+1
+            ifac(nfac)=ip
+            n=n/ip
+         else
+            ip=ip+1
+         endif
+         goto 1
+      endif
+
+c Psi averages of the diagonal and of the outer boundary coefficients
+      do j=1,n2
+         do i=2,n1
+            dbar(i,j)=0.
+            do k=1,n3
+               dbar(i,j)=dbar(i,j)+dg(i,j,k)
+            enddo
+            dbar(i,j)=dbar(i,j)/n3
+         enddo
+         do l=1,5
+            gbar(j,l)=0.
+            do k=1,n3
+               gbar(j,l)=gbar(j,l)+gpc(j,k,l)
+            enddo
+            gbar(j,l)=gbar(j,l)/n3
+         enddo
+      enddo
+
+c Unknown (i,j) is row j+n2*(i-2); psab(d,q) is the element (q,q+d)
+      do m=0,nmode
+         cm=2.*cos(2.*pi*m/n3)
+         do ieq=1,nequ
+            do id=-nband,nband
+               psab(id,ieq,m)=0.
+            enddo
+         enddo
+         do i=2,n1
+            do j=1,n2
+               ieq=j+n2*(i-2)
+               psab(0,ieq,m)=-dbar(i,j)+cm*epc(i,j)
+               if(j.gt.1)psab(-1,ieq,m)=dpc(i,j)
+               if(j.lt.n2)psab(1,ieq,m)=cpc(i,j)
+               if(i.gt.2)psab(-n2,ieq,m)=bpc(i)
+               if(i.lt.n1)then
+                  psab(n2,ieq,m)=apc(i)
+               else
+c Fold the outer ghost value into the boundary row
+                  psab(-n2,ieq,m)=psab(-n2,ieq,m)+apc(i)*gbar(j,1)
+                  if(j.gt.1)psab(-1,ieq,m)=psab(-1,ieq,m)
+     $                 +apc(i)*gbar(j,2)
+                  if(j.lt.n2)psab(1,ieq,m)=psab(1,ieq,m)
+     $                 +apc(i)*gbar(j,3)
+                  psab(0,ieq,m)=psab(0,ieq,m)+apc(i)*gbar(j,5)
+               endif
+            enddo
+         enddo
+         call bandlu(nequ,nband,nbandmax,nthsize,psab(:,:,m))
+      enddo
+
+      end
+c******************************************************************
+      subroutine psisolve(n1,n2,n3,l1,l2,b,z,ltrnsp)
+
+c z=M^-1 b, or M'^-1 b if ltrnsp. psisetup must have been called for
+c the current matrix.
+
+      include 'piccom.f'
+      include 'psicom.f'
+      integer n1,n2,n3,l1,l2
+      real b(l1,0:l2,0:*), z(l1,0:l2,0:*)
+      logical ltrnsp
+
+c Forward transform in psi. Column ieq<=nh is the real part and column
+c ieq+nh the imaginary part of the complex sequence transformed.
+      nh=(nequ+1)/2
+      do k=1,n3
+         do i=2,n1
+            do j=1,n2
+               ieq=j+n2*(i-2)
+               if(ieq.le.nh)then
+                  psxr(ieq,k-1)=b(i,j,k)
+               else
+                  psxi(ieq-nh,k-1)=b(i,j,k)
+               endif
+            enddo
+         enddo
+         if(2*nh.gt.nequ)psxi(nh,k-1)=0.
+      enddo
+      call psfft(nh,n3,-1.)
+
+c Separate the two real transforms using X(n3-m)=conj(X(m))
+      do m=0,nmode
+         mm=mod(n3-m,n3)
+         do iq=1,nh
+            pswc(iq,m)=0.5*(psxr(iq,m)+psxr(iq,mm))
+            psws(iq,m)=-0.5*(psxi(iq,m)-psxi(iq,mm))
+         enddo
+         do iq=1,nequ-nh
+            pswc(iq+nh,m)=0.5*(psxi(iq,m)+psxi(iq,mm))
+            psws(iq+nh,m)=0.5*(psxr(iq,m)-psxr(iq,mm))
+         enddo
+         if(2*nh.gt.nequ)then
+            pswc(nequ+1,m)=0.
+            psws(nequ+1,m)=0.
+         endif
+      enddo
+
+c The sine part of mode 0, and of mode n3/2 for even n3, vanishes
+      do m=0,nmode
+         call bandsolve(nequ,nband,nbandmax,nthsize,psab(:,:,m)
+     $        ,pswc(:,m),ltrnsp)
+         if(m.gt.0 .and. 2*m.ne.n3)call bandsolve(nequ,nband,nbandmax
+     $        ,nthsize,psab(:,:,m),psws(:,m),ltrnsp)
+      enddo
+
+c Inverse transform of the two packed columns
+      do m=0,nmode
+         mm=n3-m
+         do iq=1,nh
+            psxr(iq,m)=pswc(iq,m)+psws(iq+nh,m)
+            psxi(iq,m)=pswc(iq+nh,m)-psws(iq,m)
+         enddo
+         if(m.gt.0 .and. mm.gt.nmode)then
+            do iq=1,nh
+               psxr(iq,mm)=pswc(iq,m)-psws(iq+nh,m)
+               psxi(iq,mm)=pswc(iq+nh,m)+psws(iq,m)
+            enddo
+         endif
+      enddo
+      call psfft(nh,n3,1.)
+      do k=1,n3
+         do i=2,n1
+            do j=1,n2
+               ieq=j+n2*(i-2)
+               if(ieq.le.nh)then
+                  z(i,j,k)=psxr(ieq,k-1)/n3
+               else
+                  z(i,j,k)=psxi(ieq-nh,k-1)/n3
+               endif
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine psfft(nh,n,sg)
+
+c In place complex FFT of length n of each of the nh rows of
+c (psxr,psxi): X(m)=sum_k x(k) exp(sg 2 pi i m k/n), unnormalized.
+c Self-sorting (Stockham) passes, one per prime factor in ifac.
+
+      include 'piccom.f'
+      include 'psicom.f'
+      integer nh,n
+      real sg
+
+      ns=1
+      do l=1,nfac
+         if(mod(l,2).eq.1)then
+            call psfpass(nh,nhalfmax,n,ifac(l),ns,sg,psxr,psxi,psyr
+     $           ,psyi)
+         else
+            call psfpass(nh,nhalfmax,n,ifac(l),ns,sg,psyr,psyi,psxr
+     $           ,psxi)
+         endif
+         ns=ns*ifac(l)
+      enddo
+      if(mod(nfac,2).eq.1)then
+         do k=0,n-1
+            do iq=1,nh
+               psxr(iq,k)=psyr(iq,k)
+               psxi(iq,k)=psyi(iq,k)
+            enddo
+         enddo
+      endif
+
+      end
+c******************************************************************
+      subroutine psfpass(nh,ld,n,ir,ns,sg,ar,ai,br,bi)
+
+c One radix-ir pass of psfft from a to b. ns is the product of the
+c factors of the passes already done. Output ks of butterfly j takes
+c input is with the root exp(sg 2 pi i ie/n) of the table.
+
+      include 'piccom.f'
+      include 'psicom.f'
+      integer nh,ld,n,ir,ns
+      real sg
+      real ar(ld,0:n-1),ai(ld,0:n-1),br(ld,0:n-1),bi(ld,0:n-1)
+
+      nb=n/ir
+      nt=n/(ns*ir)
+      do j=0,nb-1
+         jm=mod(j,ns)
+         id=(j/ns)*ns*ir+jm
+         do ks=0,ir-1
+            ko=id+ks*ns
+            do iq=1,nh
+               br(iq,ko)=ar(iq,j)
+               bi(iq,ko)=ai(iq,j)
+            enddo
+            do is=1,ir-1
+               ie=mod(is*(jm*nt+ks*nb),n)
+               c=psct(ie)
+               s=sg*psst(ie)
+               ki=j+is*nb
+               do iq=1,nh
+                  br(iq,ko)=br(iq,ko)+c*ar(iq,ki)-s*ai(iq,ki)
+                  bi(iq,ko)=bi(iq,ko)+c*ai(iq,ki)+s*ar(iq,ki)
+               enddo
+            enddo
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine bandlu(n,nb,ldb,nbmax,ab)
+
+c In place LU factorization, without pivoting, of the n x n matrix of
+c half-bandwidth nb stored as ab(d,q)=A(q,q+d). L has a unit diagonal.
+
+      integer n,nb,ldb,nbmax
+      real ab(-nbmax:nbmax,ldb)
+
+      do iq=1,n
+         piv=ab(0,iq)
+         do ir=iq+1,min(iq+nb,n)
+            el=ab(iq-ir,ir)/piv
+            ab(iq-ir,ir)=el
+            if(el.ne.0.)then
+               do ic=iq+1,min(iq+nb,n)
+                  ab(ic-ir,ir)=ab(ic-ir,ir)-el*ab(ic-iq,iq)
+               enddo
+            endif
+         enddo
+      enddo
+
+      end
+c******************************************************************
+      subroutine bandsolve(n,nb,ldb,nbmax,ab,x,ltrnsp)
+
+c Solve A x=b, or A'x=b if ltrnsp, in place with the factors of bandlu.
+
+      integer n,nb,ldb,nbmax
+      real ab(-nbmax:nbmax,ldb),x(n)
+      logical ltrnsp
+
+      if(ltrnsp)then
+c U'w=b then L'x=w
+         do ir=1,n
+            s=x(ir)
+            do iq=max(1,ir-nb),ir-1
+               s=s-ab(ir-iq,iq)*x(iq)
+            enddo
+            x(ir)=s/ab(0,ir)
+         enddo
+         do ir=n,1,-1
+            s=x(ir)
+            do ic=ir+1,min(ir+nb,n)
+               s=s-ab(ir-ic,ic)*x(ic)
+            enddo
+            x(ir)=s
+         enddo
+      else
+c Ly=b then Ux=y
+         do ir=1,n
+            s=x(ir)
+            do iq=max(1,ir-nb),ir-1
+               s=s-ab(iq-ir,ir)*x(iq)
+            enddo
+            x(ir)=s
+         enddo
+         do ir=n,1,-1
+            s=x(ir)
+            do ic=ir+1,min(ir+nb,n)
+               s=s-ab(ic-ir,ir)*x(ic)
+            enddo
+            x(ir)=s/ab(0,ir)
+         enddo
+      endif
+
+      end
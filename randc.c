@@ -24,6 +24,16 @@ float rand_()
   }
   return x;
 }
+/* Same as rand_ but drawing from the caller's own seed with rand_r, so
+   that threads do not share (or lock) the library generator state. */
+float randr_(unsigned int *iseed)
+{
+  double xfac;
+  float x;
+  xfac=1./( ((double) RAND_MAX) + (((double) RAND_MAX)/1000000.));
+  x = ((double) rand_r(iseed))*xfac ;
+  return x;
+}
 /*
 float ran_()
 {
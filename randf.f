@@ -1,7 +1,8 @@
 c***********************************************************************
       FUNCTION GASDEV(IDUM)
-      save
-      DATA ISET/0/
+c The spare deviate is in a common so that ranstate can save it.
+      COMMON /GASCOM/ISET,GSET
+c$omp threadprivate(/gascom/)
       IF (ISET.EQ.0) THEN
  1       continue
 c Version of Feb 09. changed back to ran0
@@ -23,19 +24,19 @@ c         V2=2.*RANd()-1.
       END
 c**********************************************************************
       FUNCTION RAN0(IDUM)
-      save
 c Version of July 06 that removes the argument dependence.
-      DIMENSION V(97)
-      DATA IFF /0/
+c Each thread keeps its own shuffle table.
+      COMMON /RAN0COM/V(97),Y,IFF
+c$omp threadprivate(/ran0com/)
       IF(IFF.EQ.0)THEN
         IFF=1
         DO 11 J=1,97
-          DUM=RANd()
+          DUM=RANT()
 11      CONTINUE
         DO 12 J=1,97
-          V(J)=RANd()
+          V(J)=RANT()
 12      CONTINUE
-        Y=RANd()
+        Y=RANT()
       ENDIF
 c IHH hack to prevent errors when Y=1. Was 97.
       J=1+INT(96.9999*Y)
@@ -46,9 +47,95 @@ c         PAUSE 'RAN0 problem'
       endif
       Y=V(J)
       RAN0=Y
-      V(J)=RANd()
+      V(J)=RANT()
       RETURN
       END
+c**********************************************************************
+c Uniform deviate feeding RAN0. Unseeded threads (always the master)
+c use the C library rand(). Other threads of a threaded particle advance
+c are seeded by RANTSEED and draw from their own rand_r stream.
+      FUNCTION RANT()
+      integer iseedt
+      common /ranthr/iseedt
+c$omp threadprivate(/ranthr/)
+      if(iseedt.eq.0)then
+         RANT=RANd()
+      else
+         RANT=RANdr(iseedt)
+      endif
+      END
+c**********************************************************************
+c Give the calling thread its own random stream, unless it has one.
+      subroutine rantseed(iseed)
+      integer iseed
+      integer iseedt
+      common /ranthr/iseedt
+c$omp threadprivate(/ranthr/)
+      if(iseedt.eq.0)iseedt=iseed
+      end
+c**********************************************************************
+c Get (lset false) or set the random number state of the calling
+c thread: the RAN0 shuffle table, the spare deviate of GASDEV and the
+c seed of RANT. Unseeded threads draw from RAND, the Park-Miller
+c generator x=16807*x mod (2**31-1) of the Fortran library, whose seed
+c is only seen through IRAND. That steps it once, so the seed is
+c stepped back by the inverse of 16807, and the stream is unchanged.
+c istate(4): IFF, ISET, the rand_r seed, the RAND seed.
+c rstate(99): V(97), Y, GSET.
+      subroutine ranstate(lset,istate,rstate)
+      logical lset
+      integer istate(4)
+      real rstate(99)
+      integer*8 is
+      COMMON /RAN0COM/V(97),Y,IFF
+c$omp threadprivate(/ran0com/)
+      COMMON /GASCOM/ISET,GSET
+c$omp threadprivate(/gascom/)
+      integer iseedt
+      common /ranthr/iseedt
+c$omp threadprivate(/ranthr/)
+
+      if(lset)then
+         IFF=istate(1)
+         ISET=istate(2)
+         iseedt=istate(3)
+         if(istate(4).ne.0)call srand(istate(4))
+         do j=1,97
+            V(j)=rstate(j)
+         enddo
+         Y=rstate(98)
+         GSET=rstate(99)
+      else
+         istate(1)=IFF
+         istate(2)=ISET
+         istate(3)=iseedt
+         istate(4)=0
+         if(iseedt.eq.0)then
+            is=irand()
+            is=mod(is*1407677000_8,2147483647_8)
+            istate(4)=int(is)
+            call srand(istate(4))
+         endif
+         do j=1,97
+            rstate(j)=V(j)
+         enddo
+         rstate(98)=Y
+         rstate(99)=GSET
+      endif
+      end
+c**********************************************************************
+      block data ranthrdata
+      integer iseedt
+      common /ranthr/iseedt
+c$omp threadprivate(/ranthr/)
+      COMMON /RAN0COM/V(97),Y,IFF
+c$omp threadprivate(/ran0com/)
+      COMMON /GASCOM/ISET,GSET
+c$omp threadprivate(/gascom/)
+      data iseedt/0/
+      DATA IFF /0/
+      DATA ISET/0/
+      end
 c**********************************************************************
       FUNCTION RAN1(IDUM)
       save
@@ -0,0 +1,332 @@
+c*********************************************************************
+c Time series output to the hdf file series.h5, written by process 0
+c every ntsstep steps during the run. Each quantity is a dataset whose
+c last dimension, the record, is extended at each write. Datasets are
+c chunked and, when the library has zlib, shuffled and deflated. The
+c file and its datasets stay open for the run, and the file is flushed
+c after each record, so it can be read while the run goes on.
+c   step, time, rhoinf, itsolve (iterations of the field solve)
+c   fluxprobe, zmom(5,2), xmom(2:5,2), ymom(2:5,2) of the step
+c   diagphi, diagrho (nrused): the running radial profiles
+c   phi, rho(nrused,nthused,npsiused) if lgrid
+c The open datasets are tsdset(1:nts), named tsname(1:nts).
+c*********************************************************************
+      subroutine tsopen(lgrid,lappend,istep0)
+c Load the hdf5 module
+      use hdf5
+c Don't allow implicit definitions
+      implicit none
+c Input variables
+      logical lgrid,lappend
+      integer istep0
+c Common data
+      include 'piccom.f'
+c Local variables
+      INTEGER(HID_T) :: dset_id,space_id
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      INTEGER(HSIZE_T), DIMENSION(1) :: dims,maxdims
+      integer, allocatable :: isteps(:)
+      integer error,i
+      integer irec(3)
+
+      ltsgrid=lgrid
+      ntsrec=0
+      nts=0
+      call h5open_f(error)
+      if(lappend)then
+c Continue the series of the run restarted from, dropping any records
+c after the checkpoint.
+         call h5eset_auto_f(0,error)
+         call h5fopen_f('series.h5',H5F_ACC_RDWR_F,tsfile,error)
+         call h5eset_auto_f(1,i)
+         if(error.eq.0)then
+            call tsreopen('step')
+            dset_id=tsdset(1)
+            call h5dget_space_f(dset_id,space_id,error)
+            call h5sget_simple_extent_dims_f(space_id,dims,maxdims,
+     $           error)
+            call h5sclose_f(space_id,error)
+            allocate(isteps(max(dims(1),1_HSIZE_T)))
+            if(dims(1).gt.0)call h5dread_f(dset_id,
+     $           H5T_NATIVE_INTEGER,isteps,dims,error)
+            do i=1,int(dims(1))
+               if(isteps(i).gt.istep0)goto 1
+               ntsrec=i
+            enddo
+ 1          continue
+            call tsreopen('time')
+            call tsreopen('rhoinf')
+            call tsreopen('itsolve')
+            call tsreopen('fluxprobe')
+            call tsreopen('zmom')
+            call tsreopen('xmom')
+            call tsreopen('ymom')
+            call tsreopen('diagphi')
+            call tsreopen('diagrho')
+c The grids are written if the series has them.
+            call h5lexists_f(tsfile,'rho',ltsgrid,error)
+            if(ltsgrid)then
+               call tsreopen('phi')
+               call tsreopen('rho')
+            endif
+            write(*,*)'Continuing series.h5 after record',ntsrec
+            return
+         endif
+      endif
+      call h5fcreate_f('series.h5',H5F_ACC_TRUNC_F,tsfile,error)
+      irec(1)=1
+      call tscreate('step',H5T_NATIVE_INTEGER,irec,0)
+      call tscreate('time',H5T_NATIVE_REAL,irec,0)
+      call tscreate('rhoinf',H5T_NATIVE_REAL,irec,0)
+      call tscreate('itsolve',H5T_NATIVE_INTEGER,irec,0)
+      call tscreate('fluxprobe',H5T_NATIVE_REAL,irec,0)
+      irec(1)=5
+      irec(2)=2
+      call tscreate('zmom',H5T_NATIVE_REAL,irec,2)
+      irec(1)=4
+      call tscreate('xmom',H5T_NATIVE_REAL,irec,2)
+      call tscreate('ymom',H5T_NATIVE_REAL,irec,2)
+      irec(1)=nrused
+      call tscreate('diagphi',H5T_NATIVE_REAL,irec,1)
+      call tscreate('diagrho',H5T_NATIVE_REAL,irec,1)
+      if(ltsgrid)then
+         irec(1)=nrused
+         irec(2)=nthused
+         irec(3)=npsiused
+         call tscreate('phi',H5T_NATIVE_REAL,irec,3)
+         call tscreate('rho',H5T_NATIVE_REAL,irec,3)
+      endif
+      end
+
+c*********************************************************************
+c Append the record of step istep, whose histories must be complete
+c (after partwait).
+      subroutine tswrite(istep,time)
+      use hdf5
+      implicit none
+      integer istep
+      real time
+      include 'piccom.f'
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      integer irec(3),error
+      integer ia(1)
+      real a(1)
+
+      ntsrec=ntsrec+1
+      irec(1)=1
+      ia(1)=istep
+      call tsappi('step',ia,irec,0)
+      a(1)=time
+      call tsappr('time',a,irec,0)
+      a(1)=rhoinf
+      call tsappr('rhoinf',a,irec,0)
+      ia(1)=itsolve
+      call tsappi('itsolve',ia,irec,0)
+      a(1)=fluxprobe(istep)
+      call tsappr('fluxprobe',a,irec,0)
+      irec(1)=5
+      irec(2)=2
+      call tsappr('zmom',zmom(istep,:,:),irec,2)
+      irec(1)=4
+      call tsappr('xmom',xmom(istep,:,:),irec,2)
+      call tsappr('ymom',ymom(istep,:,:),irec,2)
+      irec(1)=nrused
+      call tsappr('diagphi',diagphi,irec,1)
+      call tsappr('diagrho',diagrho,irec,1)
+      if(ltsgrid)then
+         irec(1)=nrused
+         irec(2)=nthused
+         irec(3)=npsiused
+         call tsappr('phi',phi(1:nrused,1:nthused,1:npsiused),irec,3)
+         call tsappr('rho',rho(1:nrused,1:nthused,1:npsiused),irec,3)
+      endif
+      call h5fflush_f(tsfile,H5F_SCOPE_GLOBAL_F,error)
+      end
+
+c*********************************************************************
+c Close the series file. Must precede outputhdf, whose h5close_f would
+c close it.
+      subroutine tsclose()
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      integer error,i
+
+      do i=1,nts
+         call h5dclose_f(tsdset(i),error)
+      enddo
+      call h5fclose_f(tsfile,error)
+      call h5close_f(error)
+      end
+
+c*********************************************************************
+c Create the empty, extendible dataset name of records irec(1:nrank),
+c and keep it open. A chunk holds whole records, about 64 kB of them.
+      subroutine tscreate(name,itype,irec,nrank)
+      use hdf5
+      implicit none
+      character*(*) name
+      INTEGER(HID_T) :: itype
+      integer nrank,irec(*)
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      INTEGER(HID_T) :: dset_id,space_id,plist_id
+      INTEGER(HSIZE_T), DIMENSION(4) :: dims,maxdims,chunk
+      integer error,i,nsize
+      logical lzip
+
+      nsize=1
+      do i=1,nrank
+         dims(i)=irec(i)
+         maxdims(i)=irec(i)
+         chunk(i)=irec(i)
+         nsize=nsize*irec(i)
+      enddo
+      dims(nrank+1)=0
+      maxdims(nrank+1)=H5S_UNLIMITED_F
+      chunk(nrank+1)=max(1,16384/nsize)
+      call h5screate_simple_f(nrank+1,dims,space_id,error,maxdims)
+      call h5pcreate_f(H5P_DATASET_CREATE_F,plist_id,error)
+      call h5pset_chunk_f(plist_id,nrank+1,chunk,error)
+      call h5zfilter_avail_f(H5Z_FILTER_DEFLATE_F,lzip,error)
+      if(lzip)then
+         call h5pset_shuffle_f(plist_id,error)
+         call h5pset_deflate_f(plist_id,4,error)
+      endif
+      call h5dcreate_f(tsfile,name,itype,space_id,dset_id,error,
+     $     plist_id)
+      call h5pclose_f(plist_id,error)
+      call h5sclose_f(space_id,error)
+      nts=nts+1
+      tsdset(nts)=dset_id
+      tsname(nts)=name
+      end
+
+c*********************************************************************
+c Open the existing dataset name of a series continued, and keep it
+c open.
+      subroutine tsreopen(name)
+      use hdf5
+      implicit none
+      character*(*) name
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      integer error
+
+      nts=nts+1
+      call h5dopen_f(tsfile,name,tsdset(nts),error)
+      tsname(nts)=name
+      end
+
+c*********************************************************************
+c Write the real record a(irec(1:nrank)) as record ntsrec of name.
+      subroutine tsappr(name,a,irec,nrank)
+      use hdf5
+      implicit none
+      character*(*) name
+      real a(*)
+      integer nrank,irec(*)
+      INTEGER(HID_T) :: dset_id,fspace_id,mspace_id
+      INTEGER(HSIZE_T), DIMENSION(4) :: dims,start
+      integer error
+
+      call tsextend(name,irec,nrank,dims,start,dset_id,fspace_id,
+     $     mspace_id)
+      call h5dwrite_f(dset_id,H5T_NATIVE_REAL,a,dims,error,
+     $     mspace_id,fspace_id)
+      call tsdone(fspace_id,mspace_id)
+      end
+
+c*********************************************************************
+c Integer version of tsappr.
+      subroutine tsappi(name,ia,irec,nrank)
+      use hdf5
+      implicit none
+      character*(*) name
+      integer ia(*)
+      integer nrank,irec(*)
+      INTEGER(HID_T) :: dset_id,fspace_id,mspace_id
+      INTEGER(HSIZE_T), DIMENSION(4) :: dims,start
+      integer error
+
+      call tsextend(name,irec,nrank,dims,start,dset_id,fspace_id,
+     $     mspace_id)
+      call h5dwrite_f(dset_id,H5T_NATIVE_INTEGER,ia,dims,error,
+     $     mspace_id,fspace_id)
+      call tsdone(fspace_id,mspace_id)
+      end
+
+c*********************************************************************
+c Find the open dataset name, extend it to ntsrec records and select
+c the last of them in the file; mspace_id is the memory space of a
+c record.
+      subroutine tsextend(name,irec,nrank,dims,start,dset_id,
+     $     fspace_id,mspace_id)
+      use hdf5
+      implicit none
+      character*(*) name
+      integer nrank,irec(*)
+      INTEGER(HSIZE_T), DIMENSION(4) :: dims,start
+      INTEGER(HID_T) :: dset_id,fspace_id,mspace_id
+      INTEGER(HID_T) :: tsfile,tsdset(12)
+      integer ntsrec,nts
+      logical ltsgrid
+      common /tshdf/tsfile,tsdset,ntsrec,nts,ltsgrid
+      character*10 tsname(12)
+      common /tshdfc/tsname
+      INTEGER(HSIZE_T), DIMENSION(4) :: size,count
+      integer error,i
+
+      do i=1,nrank
+         size(i)=irec(i)
+         count(i)=irec(i)
+         start(i)=0
+         dims(i)=irec(i)
+      enddo
+      size(nrank+1)=ntsrec
+      count(nrank+1)=1
+      start(nrank+1)=ntsrec-1
+      dims(nrank+1)=1
+      do i=1,nts
+         if(tsname(i).eq.name)dset_id=tsdset(i)
+      enddo
+      call h5dset_extent_f(dset_id,size,error)
+      call h5dget_space_f(dset_id,fspace_id,error)
+      call h5sselect_hyperslab_f(fspace_id,H5S_SELECT_SET_F,start,
+     $     count,error)
+      call h5screate_simple_f(nrank+1,dims,mspace_id,error)
+      end
+
+c*********************************************************************
+      subroutine tsdone(fspace_id,mspace_id)
+      use hdf5
+      implicit none
+      INTEGER(HID_T) :: fspace_id,mspace_id
+      integer error
+
+      call h5sclose_f(mspace_id,error)
+      call h5sclose_f(fspace_id,error)
+      end
@@ -7,15 +7,26 @@ c******************************************************************
       real dt,dconverge
       integer maxits
       integer n1
-      real b(nrsize-1,0:nthsize,0:npsisize)
-     $     ,x(nrsize-1,0:nthsize,0:npsisize)
+c Newton iteration stops when the nonlinear residual is reduced by rnewton
+      real rnewton
+      parameter (rnewton=1.e-3)
+      real dtol,rtol,fres,dphi
+      integer inewt,itsum
+c b and x are (nrsize-1,0:nthsize,0:npsisize), kept between calls
+      real, allocatable :: b(:,:,:),x(:,:,:)
       integer kk1,kk2
 
 c     Variables used for calculating matrix A for debugging
-      real inputvect(nrsize-1,0:nthsize,0:npsisize),
-     $  outputvect(nrsize-1,0:nthsize ,0:npsisize)
+      real, allocatable :: inputvect(:,:,:),outputvect(:,:,:)
       integer n2,n3,j,k,l,m,n,o,jkl,mno
+      save b,x,inputvect,outputvect
 
+      if(.not.allocated(b))then
+         allocate(b(nrsize-1,0:nthsize,0:npsisize)
+     $        ,x(nrsize-1,0:nthsize,0:npsisize))
+         b=0.
+         x=0.
+      endif
 
       maxits=2*(nrused*nthused*npsiused)**0.333
       dconverge=1.e-5
@@ -27,6 +38,16 @@ c Set the potential on axis to what the solver found at the previous timestep
             phi(i,nthused,k)=phiaxis(i,2,k)
          enddo
       enddo
+
+c Newton iteration on the nonlinear Boltzmann-Poisson equation. Each
+c pass linearizes exp(phi) about the current phi and solves for the
+c next one. nnewton=1 is the historical single linearized solve.
+      if(nnewton.gt.1)call phiextrap(n1)
+      itsum=0
+      dtol=dconverge
+      if(nnewton.gt.1)dtol=10.*dconverge
+      rtol=0.
+      do 20 inewt=1,nnewton
          
       do k=1,npsiused
          do j=1,nthused
@@ -52,10 +73,34 @@ c already been calculated in innerbc.f
       enddo
 
 
-      call cg3D(n1,nthused,npsiused,b,x,dconverge,iter,maxits)
+      call cg3D(n1,nthused,npsiused,b,x,dtol,iter,maxits,rtol,fres)
+      itsum=itsum+iter
+c Stop once the nonlinear residual has dropped by rnewton
+      if(inewt.eq.1)rtol=rnewton*fres
+
+      dphi=0.
+      do k=1,npsiused
+         do j=1,nthused
+            do i=2,n1
+               dphi=max(dphi,abs(x(i,j,k)-phi(i,j,k)))
+               phi(i,j,k)=x(i,j,k)
+            enddo
+         enddo
+      enddo
+      if(iter.eq.0 .or. dphi.lt.dconverge)goto 21
+c Inner tolerance follows the size of the Newton update
+      dtol=max(dconverge,0.1*dphi)
+ 20   continue
+ 21   continue
 
 c For debugging, save matrix A and its transpose
       if (lsavemat .and. stepcount.eq.saveatstep) then
+         if(.not.allocated(inputvect))then
+            allocate(inputvect(nrsize-1,0:nthsize,0:npsisize)
+     $           ,outputvect(nrsize-1,0:nthsize,0:npsisize))
+            inputvect=0.
+            outputvect=0.
+         endif
          rshieldingsave = n1
          n2 = nthused
          n3 = npsiused
@@ -100,16 +145,9 @@ c                          reset output to to be safe
       endif
 
 
-      do k=1,npsiused
-         do j=1,nthused
-            do i=2,n1
-               phi(i,j,k)=x(i,j,k)
-            enddo
-         enddo
-      enddo
-      
 c Output the number of iterations
-      write(*,'('':'',i3,$)')iter
+      itsolve=itsum
+      if(.not.lsolvequiet)write(*,'('':'',i3,$)')itsum
 
 c     We set the potential on the inner shadow cell by second order
 c     extrapolation from the potential at i=1,2,3
@@ -168,9 +206,38 @@ c Set the psi shadow cells to their proper value to ensure periodicity
 
       end
       
+c******************************************************************
+      subroutine phiextrap(n1)
+
+c Warm start for the Newton iteration: replace phi(2:n1) by its linear
+c extrapolation from the potentials found at the previous two steps.
+
+      include 'piccom.f'
+      integer n1
+      real, allocatable :: phiprev(:,:,:)
+      integer nprev,n1prev
+      save phiprev,nprev,n1prev
+      data nprev,n1prev/0,0/
+
+      if(.not.allocated(phiprev))
+     $     allocate(phiprev(nrsize,nthsize,npsisize))
+      if(n1.ne.n1prev)nprev=0
+      n1prev=n1
+      do k=1,npsiused
+         do j=1,nthused
+            do i=2,n1
+               p=phi(i,j,k)
+               if(nprev.gt.0)phi(i,j,k)=2.*p-phiprev(i,j,k)
+               phiprev(i,j,k)=p
+            enddo
+         enddo
+      enddo
+      nprev=1
+
+      end
 c******************************************************************
 c******************************************************************
-      subroutine cg3D(n1,n2,n3,b,x,tol,iter,itmax)
+      subroutine cg3D(n1,n2,n3,b,x,tol,iter,itmax,rtol,fres)
 
 c     Subroutine to solve Ax=b, where b is an array of dimensions
 c     n1*n2*n3, considered here as a 3D matrix with dimensions
@@ -180,23 +247,102 @@ c     definite positive, we use the minimum residual variant of the
 c     algorithm
 c     Actually, A is not exactly symmetric (especially for coarse grids)
 c       so use biconjugate gradient method from Press.
+c     fres returns the largest initial residual |b-Ax|. If it is below
+c     rtol, x is already a solution and no iteration is done.
+c     The iteration (cgcore) works on copies of b and x dimensioned to
+c     the used mesh rather than to nrsize, nthsize, npsisize.
 
       include 'piccom.f'
-      include 'errcom.f'
 
       integer itmax,iter
-      real eps,delta,deltamax
-      parameter (eps=1.e-14)
       real b(nrsize-1,0:nthsize,0:npsisize),x(nrsize-1,0:nthsize
-     $     ,0:npsisize),p(nrsize-1,0:nthsize,0:npsisize),res(nrsize-1
-     $     ,0:nthsize ,0:npsisize),z(nrsize-1,0:nthsize,0:npsisize)
-     $     ,pp(nrsize-1,0:nthsize ,0:npsisize),resr(nrsize-1,0:nthsize
-     $     ,0:npsisize),zz(nrsize-1 ,0:nthsize,0:npsisize)
+     $     ,0:npsisize)
       integer n1,n2,n3
-      real tol
-      real bknum,bkden,aknum,akden
+      real tol,rtol,fres
+c Compact work arrays, used as (n1+1,0:n2+1,0:n3)
+      real bc((n1+1)*(n2+2)*(n3+1)),xc((n1+1)*(n2+2)*(n3+1))
+     $     ,p((n1+1)*(n2+2)*(n3+1)),res((n1+1)*(n2+2)*(n3+1))
+     $     ,z((n1+1)*(n2+2)*(n3+1)),pp((n1+1)*(n2+2)*(n3+1))
+     $     ,resr((n1+1)*(n2+2)*(n3+1)),zz((n1+1)*(n2+2)*(n3+1))
+
+      l1=n1+1
+      l2=n2+1
+c Zero everything, including the ghost cells which must not contribute
+      do i=1,l1*(l2+1)*(n3+1)
+         bc(i)=0.
+         xc(i)=0.
+         p(i)=0.
+         res(i)=0.
+         z(i)=0.
+         pp(i)=0.
+         resr(i)=0.
+         zz(i)=0.
+      enddo
+      call cgcopy(n1,n2,n3,nrsize-1,nthsize,b,l1,l2,bc)
+      call cgcopy(n1,n2,n3,nrsize-1,nthsize,x,l1,l2,xc)
+
+      call cgcore(n1,n2,n3,l1,l2,bc,xc,p,res,z,pp,resr,zz,adiag,tol
+     $     ,iter,itmax,rtol,fres)
+
+      call cgcopy(n1,n2,n3,l1,l2,xc,nrsize-1,nthsize,x)
+
+      end
+
+c **************************************
+
+      subroutine cgcopy(n1,n2,n3,la1,la2,a,lb1,lb2,b)
+
+c Copy the used part i=1..n1, j=1..n2, k=1..n3 of a into b.
+
+      integer n1,n2,n3,la1,la2,lb1,lb2
+      real a(la1,0:la2,0:*),b(lb1,0:lb2,0:*)
+
+      do k=1,n3
+         do j=1,n2
+            do i=1,n1
+               b(i,j,k)=a(i,j,k)
+            enddo
+         enddo
+      enddo
+
+      end
+
+c **************************************
+
+      subroutine cgcore(n1,n2,n3,l1,l2,b,x,p,res,z,pp,resr,zz,dg,tol
+     $     ,iter,itmax,rtol,fres)
+
+c     Biconjugate gradient iteration of cg3D. With the diagonal
+c     preconditioner, the update of x and of the residuals, the
+c     preconditioning and the next bknum sum share a single sweep.
+
+      include 'piccom.f'
+
+      integer n1,n2,n3,l1,l2,itmax,iter
+      real b(l1,0:l2,0:*),x(l1,0:l2,0:*),p(l1,0:l2,0:*),res(l1,0:l2
+     $     ,0:*),z(l1,0:l2,0:*),pp(l1,0:l2,0:*),resr(l1,0:l2,0:*),zz(l1
+     $     ,0:l2,0:*),dg(l1,0:l2,0:*)
+      real tol,rtol,fres
+      real delta,deltamax
+      real bknum,bkden,akden
+      logical ldiag
 
       iter=0
+      ldiag=.not.(lmgprec .or. lpsifft)
+
+c     phi is fixed during the solve, so evaluate the diagonal of A once
+      do k=1,n3
+         do j=1,n2
+            do i=2,n1
+               dg(i,j,k)=fpc(i,j)+exp(phi(i,j,k))
+            enddo
+         enddo
+      enddo
+      if(lmgprec)then
+         call mgsetup(n1,n2,n3,dg)
+      elseif(lpsifft)then
+         call psisetup(n1,n2,n3,dg)
+      endif
 c Initialize the denominators to avoid warnings at compilation
       bkden=0
       akden=0
@@ -205,49 +351,32 @@ c     Calculate initial residual r=b-Ax, where x is the potential at the
 c     previous time-step. With the conjugate gradient method, the first
 c     search direction is the first residual
 
-
-      call atimes(n1,n2,n3,x,res,.false.)
+      call atimesc(n1,n2,n3,l1,l2,x,res,dg,.false.)
       
+      fres=0.
       do k=1,n3
          do j=1,n2
             do i=2,n1
                res(i,j,k)=b(i,j,k)-res(i,j,k)
+               fres=max(fres,abs(res(i,j,k)))
 c              The following line is required for the bcg method
                resr(i,j,k)=res(i,j,k)
             enddo
-c     Inner bc lies in the rhs of poisson's equation (b)
-            res(1,j,k)=0.
-c           For debugging, also set resr to zero
-            resr(1,j,k)=0.
          enddo
       enddo
+      if(fres.lt.rtol)return
 
 c     Following line used for minimum residual method
       if (.not. lbcg) then
-         call atimes(n1,n2,n3,res,resr,.false.)
+         call atimesc(n1,n2,n3,l1,l2,res,resr,dg,.false.)
       endif
 
-      call asolve(n1,n2,n3,res,z,error0)
-
-      
+      call cgprec(n1,n2,n3,l1,l2,res,resr,z,zz,dg,bknum)
 
 c     Main loop
  100  if(iter.lt.itmax) then
          iter=iter+1
 
-         call asolve(n1,n2,n3,resr,zz,error)
-         bknum=0.
-         
-         do k=1,n3
-            do j=1,n2
-               do i=2,n1
-                  bknum=bknum+z(i,j,k)*resr(i,j,k)
-               enddo
-            enddo
-         enddo
-
-      
-
          if(iter.eq.1) then
             do k=1,n3
                do j=1,n2
@@ -255,8 +384,6 @@ c     Main loop
                      p(i,j,k)=z(i,j,k)
                      pp(i,j,k)=zz(i,j,k)
                   enddo
-                  p(1,j,k)=0.
-                  pp(i,j,k)=0.
                enddo
             enddo
          else
@@ -267,14 +394,12 @@ c     Main loop
                      p(i,j,k)=bk*p(i,j,k)+z(i,j,k)
                      pp(i,j,k)=bk*pp(i,j,k)+zz(i,j,k)
                   enddo
-                  p(1,j,k)=0.
-                  pp(1,j,k)=0.
                enddo
             enddo
          endif
          
          bkden=bknum
-         call atimes(n1,n2,n3,p,z,.false.)
+         call atimesc(n1,n2,n3,l1,l2,p,z,dg,.false.)
          akden=0.
          do k=1,n3
             do j=1,n2
@@ -285,9 +410,10 @@ c     Main loop
          enddo
          ak=bknum/akden
 c        Give bcg option by using lbcg as transpose flag
-         call atimes(n1,n2,n3,pp,zz,lbcg)
+         call atimesc(n1,n2,n3,l1,l2,pp,zz,dg,lbcg)
          
          deltamax=0.
+         bknum=0.
          do k=1,n3
             do j=1,n2
                do i=2,n1
@@ -299,45 +425,103 @@ c        Give bcg option by using lbcg as transpose flag
                   res(i,j,k)=res(i,j,k)-ak*z(i,j,k)
                   resr(i,j,k)=resr(i,j,k)-ak*zz(i,j,k)
                enddo
+               if(ldiag)then
+c Diagonal preconditioning of both residuals for the next iteration
+                  do i=2,n1-1
+                     z(i,j,k)=-res(i,j,k)/dg(i,j,k)
+                     zz(i,j,k)=-resr(i,j,k)/dg(i,j,k)
+                     bknum=bknum+z(i,j,k)*resr(i,j,k)
+                  enddo
+                  i=n1
+                  z(i,j,k)=-res(i,j,k)/(dg(i,j,k)-apc(i)*gpc(j,k,5))
+                  zz(i,j,k)=-resr(i,j,k)/(dg(i,j,k)-apc(i)*gpc(j,k,5))
+                  bknum=bknum+z(i,j,k)*resr(i,j,k)
+               endif
             enddo
          enddo
 
          if(deltamax.ge.tol) then
-            call asolve(n1,n2,n3,res,z,error)
-c            write(*,*) iter,deltamax,error
+            if(.not.ldiag)
+     $           call cgprec(n1,n2,n3,l1,l2,res,resr,z,zz,dg,bknum)
             goto 100
          endif
 
       endif
 
-
 c The iteration number is larger than itmax, therefore leave the solver
       return
       
       end 
 
+c **************************************
+
+      subroutine cgprec(n1,n2,n3,l1,l2,res,resr,z,zz,dg,bknum)
+
+c     Precondition the residuals of cgcore, z=Atilde^-1*res and
+c     zz=Atilde'^-1*resr (Atilde^-1*resr for the minimum residual
+c     variant), and return bknum=z.resr.
+
+      include 'piccom.f'
+
+      integer n1,n2,n3,l1,l2
+      real res(l1,0:l2,0:*),resr(l1,0:l2,0:*),z(l1,0:l2,0:*),zz(l1
+     $     ,0:l2,0:*),dg(l1,0:l2,0:*)
+      real bknum
+
+      call asolve(n1,n2,n3,l1,l2,res,z,dg,error,.false.)
+c     The second sequence needs the transposed preconditioner
+      call asolve(n1,n2,n3,l1,l2,resr,zz,dg,error,lbcg)
+      bknum=0.
+      do k=1,n3
+         do j=1,n2
+            do i=2,n1
+               bknum=bknum+z(i,j,k)*resr(i,j,k)
+            enddo
+         enddo
+      enddo
+
+      end
 
 c **************************************
 
-      subroutine asolve(n1,n2,n3,b,z,error)
+      subroutine asolve(n1,n2,n3,l1,l2,b,z,dg,error,ltrnsp)
 
 c     Preconditioning subroutine. if Atilde is the preconditioning
-c     matrix, returns z=Atilde^-1*b.
+c     matrix, returns z=Atilde^-1*b, or z=Atilde'^-1*b if ltrnsp.
+c     Atilde is the diagonal of A, or a multigrid V-cycle if lmgprec,
+c     or A with phi averaged over psi if lpsifft.
 
       include 'piccom.f'
       include 'errcom.f'
 
-      real b(nrsize-1,0:nthsize,0:npsisize), z(nrsize-1,0:nthsize
-     $     ,0:npsisize)
+      integer n1,n2,n3,l1,l2
+      real b(l1,0:l2,0:*),z(l1,0:l2,0:*),dg(l1,0:l2,0:*)
       real error
-      integer n1,n2,n3
+      logical ltrnsp
 
       error=0.
+
+      if(lmgprec .or. lpsifft)then
+         do k=1,n3
+            do j=1,n2
+               do i=2,n1
+                  error=error+b(i,j,k)**2
+               enddo
+            enddo
+         enddo
+         if(lmgprec)then
+            call mgsolve(n1,n2,n3,l1,l2,b,z,ltrnsp)
+         else
+            call psisolve(n1,n2,n3,l1,l2,b,z,ltrnsp)
+         endif
+         error=sqrt(error)
+         return
+      endif
       
       do k=1,n3
          do j=1,n2
             do i=2,n1-1
-               z(i,j,k)=b(i,j,k)/(-fpc(i,j)-exp(phi(i,j,k)))
+               z(i,j,k)=-b(i,j,k)/dg(i,j,k)
                error=error+b(i,j,k)**2
             enddo
          enddo
@@ -347,8 +531,7 @@ c     matrix, returns z=Atilde^-1*b.
       
       do k=1,n3
          do j=1,n2
-            z(i,j,k)=b(i,j,k)/(-fpc(i,j)-exp(phi(i,j,k))
-     $           +apc(i)*gpc(j,k,5))
+            z(i,j,k)=-b(i,j,k)/(dg(i,j,k)-apc(i)*gpc(j,k,5))
             error=error+b(i,j,k)**2
          enddo
       enddo
@@ -361,14 +544,31 @@ c **************************************
 
       subroutine atimes(n1,n2,n3,x,res,ltrnsp)
 
+c Outputs res=Ax or A'x for vectors of the full mesh size, with the
+c diagonal set by the last call to cg3D.
+
       include 'piccom.f'
-      include 'errcom.f'
-c Outputs res=Ax or A'x, where A is the finite volumes stiffness matrix
       real x(nrsize-1,0:nthsize,0:npsisize), res(nrsize-1
      $     ,0:nthsize ,0:npsisize)
       integer n1,n2,n3
       logical ltrnsp
 
+      call atimesc(n1,n2,n3,nrsize-1,nthsize,x,res,adiag,ltrnsp)
+
+      end
+
+c **************************************
+
+      subroutine atimesc(n1,n2,n3,l1,l2,x,res,dg,ltrnsp)
+
+      include 'piccom.f'
+      include 'errcom.f'
+c Outputs res=Ax or A'x, where A is the finite volumes stiffness matrix
+c x and res have leading dimensions l1,l2; the diagonal dg is compact.
+      integer n1,n2,n3,l1,l2
+      real x(l1,0:l2,0:*), res(l1,0:l2,0:*), dg(n1+1,0:n2+1,0:*)
+      logical ltrnsp
+
 
       if (ltrnsp) then
 
@@ -389,7 +589,7 @@ c             x(i=1)=0, that element doesn't affect the solution
      $           + dpc(i,j+1)*x(i,j+1,k)
      $           + cpc(i,j-1)*x(i,j-1,k)
      $           + epc(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $           - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $           - dg(i,j,k)*x(i,j,k)
             enddo
             i=n1-1
             res(i,j,k) = (bpc(i+1) + gpc(j,k,1)*apc(i+1))*x(i+1,j,k)
@@ -397,14 +597,14 @@ c             x(i=1)=0, that element doesn't affect the solution
      $        + dpc(i,j+1)*x(i,j+1,k)
      $        + cpc(i,j-1)*x(i,j-1,k)
      $        + epc(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $        - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $        - dg(i,j,k)*x(i,j,k)
             i=n1
             res(i,j,k) = bpc(i+1)*x(i+1,j,k)
      $        + apc(i-1)*x(i-1,j,k)
      $        + (dpc(i,j+1) + gpc(j+1,k,2)*apc(i))*x(i,j+1,k)
      $        + (cpc(i,j-1) + gpc(j-1,k,3)*apc(i))*x(i,j-1,k)
      $        + epc(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $        - (fpc(i,j) + exp(phi(i,j,k)) - gpc(j,k,5)*apc(i))
+     $        - (dg(i,j,k) - gpc(j,k,5)*apc(i))
      $        *x(i,j,k)
          enddo
       enddo
@@ -417,7 +617,7 @@ c             x(i=1)=0, that element doesn't affect the solution
      $        + dpc(i,j+1)*x(i,j+1,k)
      $        + cpc(i,j-1)*x(i,j-1,k)
      $        + epc(i,j)*(x(i,j,k+1)+x(i,j,n3))
-     $        - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $        - dg(i,j,k)*x(i,j,k)
          enddo
          i=n1-1
          res(i,j,k) = (bpc(i+1) + gpc(j,k,1)*apc(i+1))*x(i+1,j,k)
@@ -425,14 +625,14 @@ c             x(i=1)=0, that element doesn't affect the solution
      $     + dpc(i,j+1)*x(i,j+1,k)
      $     + cpc(i,j-1)*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,k+1)+x(i,j,n3))
-     $     - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $     - dg(i,j,k)*x(i,j,k)
          i=n1
          res(i,j,k) = bpc(i+1)*x(i+1,j,k)
      $     + apc(i-1)*x(i-1,j,k)
      $     + (dpc(i,j+1) + gpc(j+1,k,2)*apc(i))*x(i,j+1,k)
      $     + (cpc(i,j-1) + gpc(j-1,k,3)*apc(i))*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,k+1)+x(i,j,n3))
-     $     - (fpc(i,j) + exp(phi(i,j,k)) - gpc(j,k,5)*apc(i))
+     $     - (dg(i,j,k) - gpc(j,k,5)*apc(i))
      $     *x(i,j,k)
       enddo
       k=n3
@@ -443,7 +643,7 @@ c             x(i=1)=0, that element doesn't affect the solution
      $        + dpc(i,j+1)*x(i,j+1,k)
      $        + cpc(i,j-1)*x(i,j-1,k)
      $        + epc(i,j)*(x(i,j,1)+x(i,j,k-1))
-     $        - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $        - dg(i,j,k)*x(i,j,k)
          enddo
          i=n1-1
          res(i,j,k) = (bpc(i+1) + gpc(j,k,1)*apc(i+1))*x(i+1,j,k)
@@ -451,14 +651,14 @@ c             x(i=1)=0, that element doesn't affect the solution
      $     + dpc(i,j+1)*x(i,j+1,k)
      $     + cpc(i,j-1)*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,1)+x(i,j,k-1))
-     $     - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $     - dg(i,j,k)*x(i,j,k)
          i=n1
          res(i,j,k) = bpc(i+1)*x(i+1,j,k)
      $     + apc(i-1)*x(i-1,j,k)
      $     + (dpc(i,j+1) + gpc(j+1,k,2)*apc(i))*x(i,j+1,k)
      $     + (cpc(i,j-1) + gpc(j-1,k,3)*apc(i))*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,1)+x(i,j,k-1))
-     $     - (fpc(i,j) + exp(phi(i,j,k)) - gpc(j,k,5)*apc(i))
+     $     - (dg(i,j,k) - gpc(j,k,5)*apc(i))
      $     *x(i,j,k)
       enddo
 
@@ -473,7 +673,7 @@ c Bulk iteration for A
             do i=2,n1-1
                res(i,j,k)=apc(i)*x(i+1,j,k)+bpc(i)*x(i-1,j,k)+cpc(i,j)
      $              *x(i,j+1,k)+dpc(i,j)*x(i,j-1,k)+epc(i,j)*(x(i,j,k+1)
-     $              +x(i,j,k-1))-(fpc(i,j)+exp(phi(i,j,k)))*x(i ,j,k)
+     $              +x(i,j,k-1))-dg(i,j,k)*x(i ,j,k)
             enddo
          enddo
       enddo
@@ -483,7 +683,7 @@ c Bulk iteration for A
          do i=2,n1-1
             res(i,j,k)=apc(i)*x(i+1,j,k)+bpc(i)*x(i-1,j,k)+cpc(i,j) *x(i
      $           ,j+1,k)+dpc(i,j)*x(i,j-1,k)+epc(i,j)*(x(i,j,k+1) +x(i,j
-     $           ,n3))-(fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $           ,n3))-dg(i,j,k)*x(i,j,k)
          enddo
       enddo
       k=n3
@@ -491,7 +691,7 @@ c Bulk iteration for A
          do i=2,n1-1
             res(i,j,k)=apc(i)*x(i+1,j,k)+bpc(i)*x(i-1,j,k)+cpc(i,j) *x(i
      $           ,j+1,k)+dpc(i,j)*x(i,j-1,k)+epc(i,j)*(x(i,j,1) +x(i,j,k
-     $           -1))-(fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $           -1))-dg(i,j,k)*x(i,j,k)
 
          enddo
       enddo
@@ -514,7 +714,7 @@ c The solution x one node further the boundary
      $        + cpc(i,j)*x(i,j+1,k)
      $        + dpc(i,j)*x(i,j-1,k)
      $        + epc(i,j)*(x(i,j,k+1)+x(i,j,k-1))
-     $        - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $        - dg(i,j,k)*x(i,j,k)
          enddo
 
          k=1
@@ -529,7 +729,7 @@ c The solution x one node further the boundary
      $     + cpc(i,j)*x(i,j+1,k)
      $     + dpc(i,j)*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,k+1)+x(i,j,n3))
-     $     - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $     - dg(i,j,k)*x(i,j,k)
 
          k=n3
          x(i+1,j,k) = gpc(j,k,1)*x(i-1,j,k)
@@ -543,7 +743,7 @@ c The solution x one node further the boundary
      $     + cpc(i,j)*x(i,j+1,k)
      $     + dpc(i,j)*x(i,j-1,k)
      $     + epc(i,j)*(x(i,j,1)+x(i,j,k-1))
-     $     - (fpc(i,j)+exp(phi(i,j,k)))*x(i,j,k)
+     $     - dg(i,j,k)*x(i,j,k)
 
       enddo
 
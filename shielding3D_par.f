@@ -4,6 +4,7 @@ c******************************************************************
 
       include 'piccom.f'
       include 'errcom.f'
+      include 'mpif.h'
 c cg_comm is the subset of MPI_COMM_WORLD communicator used for the
 c bloc conjugate gradient
       integer cg_comm,myid2
@@ -11,6 +12,13 @@ c bloc conjugate gradient
       integer maxits
       integer n1
       integer kk1,kk2
+c Newton iteration stops when the nonlinear residual is reduced by rnewton
+      real rnewton
+      parameter (rnewton=1.e-3)
+      real dtol,rtol,fres,dphi
+c     dphi as a one-element buffer for the broadcast
+      real dphibuf(1)
+      integer inewt,itsum
 
 
       maxits=2*(nrused*nthused*npsiused)**0.333
@@ -29,13 +37,35 @@ c     (nrsize+1)*(ntsize+1)*(npsize+1) and the density as
 c     (nrsize-1)*(ntsize-1)*(npsize-1). With the paralle version,
 c     because of the indexes, it is much simpler to take all the arrays
 c     with size (nrsize+1)*(ntsize+1)*(npsize+1)
-      call fcalc3Dpar(nrsize+1,nthsize+1,npsisize+1,n1+1,nthused+2
-     $     ,npsiused+2,maxits,dconverge,iter,cg_comm,myid2)
-      
+c     Newton iteration as in shielding3D. Every process of cg_comm
+c     needs the updated phi for the next linearization.
+      if(nnewton.gt.1)call phiextrap(n1)
+      itsum=0
+      dtol=dconverge
+      if(nnewton.gt.1)dtol=10.*dconverge
+      rtol=0.
+      do 20 inewt=1,nnewton
+         call fcalc3Dpar(nrsize+1,nthsize+1,npsisize+1,n1+1,nthused+2
+     $        ,npsiused+2,maxits,dtol,iter,cg_comm,myid2,rtol,fres,dphi)
+         itsum=itsum+iter
+         if(inewt.eq.1)rtol=rnewton*fres
+         if(nnewton.gt.1)then
+            dphibuf(1)=dphi
+            call MPI_BCAST(dphibuf,1,MPI_REAL,0,cg_comm,ierr)
+            dphi=dphibuf(1)
+            if(iter.eq.0 .or. dphi.lt.dconverge
+     $           .or. inewt.eq.nnewton)goto 21
+            call MPI_BCAST(phi,(nrsize+1)*(nthsize+1)*(npsiused+2)
+     $           ,MPI_REAL,0,cg_comm,ierr)
+            dtol=max(dconverge,0.1*dphi)
+         endif
+ 20   continue
+ 21   continue
 
 c Output the number of iterations
+      itsolve=itsum
       if(myid2.eq.0)  then
-         write(*,'('':'',i3,$)')iter
+         if(.not.lsolvequiet)write(*,'('':'',i3,$)')itsum
 
 c     We set the potential on the inner shadow cell by second order
 c     extrapolation from the potential at i=1,2,3